@@ -0,0 +1,44 @@
+//
+//  BoardTransform.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef BoardTransform_hpp
+#define BoardTransform_hpp
+
+#include "TwoDimCsp.hpp"
+
+#include <vector>
+
+namespace Csp {
+
+// One of the 16 ways of mapping a square board onto itself which turn a
+// futoshiki into a futoshiki: the 8 rotations and reflections of the square,
+// each optionally combined with reversing the values (v -> size + 1 - v),
+// which flips every inequality.
+struct BoardTransform {
+    // applied in this order
+    bool transpose = false;
+    bool flipRows = false; // top to bottom
+    bool flipCols = false; // left to right
+    bool reverseValues = false;
+    
+    // all 16, the identity first
+    static std::vector<BoardTransform> All();
+    
+    bool IsIdentity() const { return !transpose && !flipRows && !flipCols && !reverseValues; }
+    
+    // (column, row) as for TwoDimCsp
+    TwoDimCsp::CellCoords Apply(const TwoDimCsp::CellCoords& coords, unsigned long size) const;
+    // cells keyed row by row, as for TwoDimCsp
+    unsigned long ApplyToKey(unsigned long key, unsigned long size) const;
+    int ApplyToValue(int val, unsigned long size) const;
+    
+    crow::json::wvalue Serialize() const;
+}; // BoardTransform
+
+} // ::Csp
+
+#endif /* BoardTransform_hpp */
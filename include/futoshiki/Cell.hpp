@@ -35,12 +35,14 @@ public:
     static constexpr auto kUnsolvedSymbol = 0;
     
     // assumes the possible values vector is sorted
-    Cell(int initVal, const std::string& id, const std::set<int>& possibleValues, ConstraintSatisfactionProblem* csp);
+    Cell(int initVal, const std::string& id, const std::set<int>& possibleValues, ConstraintSatisfactionProblem* csp, unsigned long key);
     Cell() = delete;
     Cell(const Cell& other) = default;
     Cell& operator =(const Cell&) = default;
     // only shallow copy available, use UpdateConstraintPointers once the constraints are copied as well;
     Cell(const Cell& other, ConstraintSatisfactionProblem*);
+    // same as above, but also (re)sets the key of the cell within the new CSP
+    Cell(const Cell& other, unsigned long key, ConstraintSatisfactionProblem*);
 
     Cell(const crow::json::rvalue& cellJson);
     
@@ -66,6 +68,7 @@ public:
     bool IsSolved() const { return m_val != kUnsolvedSymbol; }
     int Value() const { return m_val; }
     std::string Id() const {return m_id; }
+    unsigned long Key() const { return m_key; }
     // for constraint classes (EqualityConstaint need access to this reference)
     // should be ok, as the lifetime of the constraints and the cells are the same (CSP lifetime)
     // TODO: this maybe requires some more thinking (what's the point of all the weak and shared
@@ -82,9 +85,14 @@ private:
     // also reports if newly solved to the parent csp
     bool SetIfPossible();
     void ReportChangeToConstraints();
+    // lets the parent csp know the number of possible values changed
+    void ReportDomainChange() const;
+    // lets the parent csp know val is no longer possible, before it is erased
+    void ReportValueRemoved(int val) const;
     
     int m_val;
     std::string m_id;
+    unsigned long m_key; // the key of the cell within the parent csp
     std::set<int> m_possibleValues;
     std::vector<std::weak_ptr<Constraint>> m_appliedConstraints;
     ConstraintSatisfactionProblem* m_csp;
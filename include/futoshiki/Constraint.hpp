@@ -77,6 +77,7 @@ public:
         , m_solved(false) // up to the derived class to check this
         , m_operator(op)
         , m_relatedCellsChanged(true)
+        , m_changedWhileApplying(false)
         , m_id(id)
         , m_csp(csp)
     { }
@@ -140,6 +141,9 @@ protected:
     // false if none of the cells to which the constraint pertains
     // have reported through ReportChanged() since the last time we did Apply()
     bool m_relatedCellsChanged;
+    // set by ReportChanged, and reset when Apply starts: at the end of Apply
+    // it says whether applying the constraint changed its own cells
+    bool m_changedWhileApplying;
     
     // if the cell becomes inactive or active, report this to the CSP
     // occcurs either when:
@@ -11,6 +11,7 @@
 #include "CspSolver.hpp"
 #include "InequalityConstraint.hpp"
 #include "EqualityConstraint.hpp"
+#include "DomainSizeBuckets.hpp"
 
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -27,23 +28,107 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <optional>
+#include <cstdint>
 
 namespace Csp {
 
 class Cell;
 
 struct Guess {
+    // what the guess says about the value of the cell
+    enum class Type {
+        Assign,    // == val
+        Exclude,   // != val
+        LessEqual, // <= val
+        Greater,   // > val
+    };
+    
     unsigned long cellKey;
     int val;
+    Type type = Type::Assign;
+    
+    // whether the guess is true if the cell has the given value
+    bool HoldsFor(int value) const {
+        switch (type) {
+            case Type::Assign: return value == val;
+            case Type::Exclude: return value != val;
+            case Type::LessEqual: return value <= val;
+            case Type::Greater: return value > val;
+        }
+        return false;
+    }
+    
+    Guess Negated() const {
+        switch (type) {
+            case Type::Assign: return {cellKey, val, Type::Exclude};
+            case Type::Exclude: return {cellKey, val, Type::Assign};
+            case Type::LessEqual: return {cellKey, val, Type::Greater};
+            case Type::Greater: return {cellKey, val, Type::LessEqual};
+        }
+        return *this;
+    }
     
     crow::json::wvalue Serialize() const {
         auto out = crow::json::wvalue();
         out["cell"] = cellKey;
         out["val"] = val;
+        switch (type) {
+            case Type::Assign: out["type"] = "=="; break;
+            case Type::Exclude: out["type"] = "!="; break;
+            case Type::LessEqual: out["type"] = "<="; break;
+            case Type::Greater: out["type"] = ">"; break;
+        }
+        return out;
+    }
+    
+    friend bool operator==(const Guess& lhs, const Guess& rhs) {
+        return lhs.cellKey == rhs.cellKey && lhs.val == rhs.val && lhs.type == rhs.type;
+    }
+};
+
+// A mapping of the cells and values of a csp onto themselves, under which
+// solutions stay solutions. Empty maps are the identity.
+struct CspSymmetry {
+    // by key: the key the cell is moved to
+    std::vector<unsigned long> cellMap;
+    // by value: the value it becomes
+    std::vector<int> valueMap;
+    
+    int MapValue(int val) const {
+        return valueMap.empty() || val <= 0 ? val : valueMap.at(val);
+    }
+    // values in key order, as for CompactValues
+    std::vector<std::uint8_t> Apply(const std::vector<std::uint8_t>& values) const {
+        std::vector<std::uint8_t> out(values.size());
+        for (std::size_t key = 0; key < values.size(); ++key) {
+            out[cellMap.empty() ? key : cellMap.at(key)] = static_cast<std::uint8_t>(MapValue(values[key]));
+        }
         return out;
     }
 };
 
+// How a csp's symmetries can be broken. Either:
+// - fixedCells: every class of symmetric solutions has exactly
+//   fixedCellsMultiplier solutions, one of which agrees with these cells
+// - symmetries: the symmetries of the csp (bar the identity), the
+//   solver only accepts solutions which are lexicographically smallest
+//   among their images
+struct SymmetryBreaking {
+    std::vector<Guess> fixedCells;
+    unsigned long fixedCellsMultiplier = 1;
+    std::vector<CspSymmetry> symmetries;
+    
+    bool Empty() const { return fixedCells.empty() && symmetries.empty(); }
+};
+
+// whether a guess holds in the current state of a csp
+enum class GuessState {
+    True,
+    False,
+    Undecided,
+};
+
 class ConstraintSatisfactionProblem {
     template <typename CSP, typename Sfinae> friend class CspSolver;
     // friend class CspSolver;
@@ -81,16 +166,61 @@ public:
     );
     
     void ReportIfCellNewlySolved();
+    void ReportCellDomainChanged(unsigned long cellKey, std::size_t domainSize);
+    void ReportCellValueRemoved(unsigned long cellKey, int val);
     void ReportIfConstraintNewlySolved();
     
     void ReportIfConstraintBecomesActive();
     void ReportIfConstraintBecomesInactive();
     
-    bool IsCompletelySolved() { return m_completelySolved; }
+    bool IsCompletelySolved() const { return m_completelySolved; }
     bool ProvenInValid() { return m_provenValid;}
     
     unsigned long FindCellIdx(const std::string& cellId);
     
+    GuessState EvaluateGuess(const Guess& guess) const;
+    // both return false if the csp turned out to be invalid as a result
+    bool ApplyGuess(const Guess& guess);
+    bool RefuteGuess(const Guess& guess);
+    
+    // the keys of the cells whose possible values changed since the last call
+    // (may contain duplicates)
+    std::vector<unsigned long> TakeChangedCells();
+    
+    // the values of the cells in key order, Cell::kUnsolvedSymbol for unsolved cells
+    std::vector<std::uint8_t> CompactValues() const;
+    // sets the cells to the given values (in key order), skipping Cell::kUnsolvedSymbol
+    // returns false if one of the values is not possible
+    bool AssignCompactValues(const std::vector<std::uint8_t>& values);
+    
+    // the possible values of every cell as bitmasks, in key order
+    // empty if a possible value does not fit into a mask
+    using DomainMasks = std::vector<std::uint64_t>;
+    DomainMasks GetDomainMasks() const;
+    // TranspositionTable::Hash of GetDomainMasks, kept up to date as values
+    // are removed (meaningless if GetDomainMasks is empty)
+    std::uint64_t DomainHash() const { return m_domainHash; }
+    // log2 of the product of the numbers of possible values of the cells:
+    // how many boards are left to search, 0 once every cell is solved
+    double Log2SearchSpace() const;
+    
+    // raising the level makes the constraints which are not solved yet look
+    // at their cells again, so propagation picks up where the weaker level
+    // left off
+    void SetPropagationLevel(PropagationLevel level);
+    PropagationLevel GetPropagationLevel() const { return m_propagationLevel; }
+    
+    // no symmetries known for a generic csp
+    virtual SymmetryBreaking FindSymmetries() const { return {}; }
+    // maps a solution onto a random symmetric one
+    virtual CspSymmetry RandomSymmetry() const { return {}; }
+    // the values (in key order) of a solution found without searching the
+    // tree, if there is a way to: no local search for a generic csp
+    virtual std::optional< std::vector<std::uint8_t> > SearchLocally(
+        unsigned long /*maxSteps*/,
+        const SolveBudget& /*budget*/
+    ) const { return std::nullopt; }
+    
     virtual crow::json::wvalue Serialize() const;
     crow::json::wvalue SerializeCsp() const;
     std::vector<crow::json::wvalue> SerializeCells() const;
@@ -115,13 +245,18 @@ protected:
     std::set<int> m_defaultPossibleValues;
     
 private:
+    // (re)builds m_unsolvedCells and m_domainHash from scratch, after that
+    // they are kept up to date by the cells reporting their domain changes
+    void InitUnsolvedCells();
     
     // returns a set of guess which are mutually exclusive
     // and exhaustive:
     // - no two guesses can result in the same completeSolve
     // - if none of the guesses resultr in a completeSolve,
     //   then such a thing does not exist
-    std::vector<Guess> GetGuesses(bool random) const;
+    // Enumerate gives one guess per possible value of a cell, the other
+    // schemes give a guess and its negation.
+    std::vector<Guess> GetGuesses(bool random, BranchingScheme scheme = BranchingScheme::Enumerate) const;
     
     bool m_completelySolved;
     bool m_provenValid;
@@ -130,6 +265,12 @@ private:
     unsigned long m_numActiveConstraints;
     
     unsigned long m_numCells;
+    
+    // used to pick the cell to guess in GetGuesses
+    DomainSizeBuckets m_unsolvedCells;
+    std::vector<unsigned long> m_changedCells;
+    PropagationLevel m_propagationLevel;
+    std::uint64_t m_domainHash;
 }; // ConstraintSatisfactionProblem
 
 } // ::Csp
@@ -9,6 +9,7 @@
 #define CspSolver_hpp
 
 // #include "Constraint.hpp"
+#include "SolverOptions.hpp"
 
 #ifdef __clang__
 #pragma clang diagnostic push
@@ -22,12 +23,23 @@
 #endif
 
 #include <vector>
+#include <map>
+#include <utility>
 #include <stack>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <cstdint>
+#include <limits>
 
 namespace Csp {
 
 struct Guess;
+class Constraint;
 class ConstraintSatisfactionProblem;
+class NogoodDatabase;
+class TranspositionTable;
+struct SymmetryBreaking;
 
 template<typename CSP, typename Sfinae = void>
 class CspSolver;
@@ -37,9 +49,9 @@ using EnableIfPolicy = typename std::enable_if_t< std::is_base_of<ConstraintSati
 
 template <typename CSP>
 class CspSolver <CSP, EnableIfPolicy<CSP> > {
-    static constexpr unsigned int kMaxGuessDepth = 4;
 public:
-    CspSolver(CSP&& startingPoint);
+    CspSolver(CSP&& startingPoint, const SolverOptions& options = SolverOptions());
+    ~CspSolver();
     
     struct SolveSolution {
         bool completeSolve;
@@ -52,6 +64,7 @@ public:
             NotUnique,
             GuessDepthExceeded,
             NotYetSolved,
+            BudgetExhausted,
         };
         
         struct Reason {
@@ -99,11 +112,84 @@ public:
                 os << "Not uniquely solvable.";
                 break;
             case SolveSolution::ReasonType::GuessDepthExceeded:
-                os << "Not proveably uniquely solveable in < " << kMaxGuessDepth << " guesses.";
+                os << "Not proveably uniquely solveable within the guess depth limit.";
+                break;
+            case SolveSolution::ReasonType::BudgetExhausted:
+                os << "Ran out of budget.";
+                break;
         }
         return os;
     };
     
+    struct SearchStats {
+        unsigned long nodes = 0; // csps we propagated, including the starting point
+        unsigned long failures = 0; // of those, the ones that turned out invalid
+        unsigned long probes = 0; // values tried on a copy while probing
+        unsigned long probeRemovals = 0; // of those, the ones that failed
+        unsigned long transpositionHits = 0; // states we did not explore again
+        
+        crow::json::wvalue Serialize() const {
+            crow::json::wvalue out;
+            out["nodes"] = nodes;
+            out["failures"] = failures;
+            out["probes"] = probes;
+            out["probeRemovals"] = probeRemovals;
+            out["transpositionHits"] = transpositionHits;
+            return out;
+        }
+    };
+    
+    // the value of every cell, in key order
+    using CompactSolution = std::vector<std::uint8_t>;
+    
+    struct SolutionCount {
+        unsigned long count;
+        // false if we stopped at the limit (or ran out of budget): then there
+        // are at least count solutions
+        bool exact;
+        bool budgetExhausted;
+        SearchStats stats;
+    };
+    
+    struct FoundSolution {
+        CompactSolution values;
+        // the guesses that led to the solution
+        std::vector<Guess> guesses;
+    };
+    
+    // what it takes to solve the starting point
+    struct DifficultyRating {
+        // the weakest propagation that solves it without guessing, HallSets
+        // if none of them do
+        PropagationLevel propagation;
+        // probing the root was needed on top of HallSets
+        bool needsProbing;
+        // nested guesses needed on top of probing, 0 if none were
+        unsigned int guessDepth;
+        // false if there is no solution, or it was not proven to be the only
+        // one (within the guess depth limit and the budget)
+        bool unique;
+        
+        // to compare ratings by: 0 to 3 for the propagation levels, 4 for
+        // probing, 4 + the guess depth for guessing
+        unsigned int Score() const {
+            if (guessDepth > 0) {
+                return 4 + guessDepth;
+            }
+            return needsProbing ? 4 : static_cast<unsigned int>(propagation);
+        }
+        
+        crow::json::wvalue Serialize() const {
+            crow::json::wvalue out;
+            out["propagation"] = PropagationLevelName(propagation);
+            out["needsProbing"] = needsProbing;
+            out["guessDepth"] = guessDepth;
+            out["unique"] = unique;
+            out["score"] = Score();
+            return out;
+        }
+    };
+    
 private:
     using GuessSequence = std::vector<Guess>;
     struct SolveAttempt {
@@ -127,21 +213,191 @@ public:
     SolveSolution Solve();
     SolveSolution SolveRandom();
     SolveSolution SolveUnique();
+    // Same outcomes as SolveUnique. Once a first solution is found, restarts
+    // with a nogood forbidding exactly that solution, and tries values which
+    // differ from it first, so a second solution (if any) turns up quickly.
+    SolveSolution CheckUnique();
+    // like Solve, but first only allows to deviate from the first guess
+    // 0 times, then once, twice, ... on the way to a solution
+    SolveSolution SolveLimitedDiscrepancy();
+    // explores the whole tree (or until limit solutions were found, if limit > 0)
+    // without keeping the solutions around
+    SolutionCount CountSolutions(unsigned long limit = 0);
+    // Tries the propagation levels from the weakest up, then probing the
+    // root, then guessing with iterative deepening (up to maxGuessDepth).
+    // Each step carries on from the fixpoint of the one before, so the
+    // puzzle only gets propagated once. Learned nogoods propagate too, so
+    // ratings only compare between fresh solvers.
+    // Gives up as soon as the score is sure to be above stopAbove: then the
+    // rating is as far as it got, and not unique.
+    DifficultyRating RateDifficulty(unsigned int stopAbove = std::numeric_limits<unsigned int>::max());
+    // also gives the outcome of the search the rating took: that of
+    // SolveUnique with iterative deepening, NotYetSolved if it gave up above
+    // stopAbove
+    DifficultyRating RateDifficulty(SolveSolution& result, unsigned int stopAbove = std::numeric_limits<unsigned int>::max());
+    
+    // Walks the search tree one solution at a time. The search is paused in
+    // between, and only the csps along the current branch are kept.
+    // The solver has to outlive the enumerator.
+    class SolutionEnumerator {
+    public:
+        explicit SolutionEnumerator(CspSolver& solver);
+        
+        // std::nullopt once every solution has been returned
+        std::optional<CompactSolution> Next();
+        
+        const SearchStats& Stats() const { return m_stats; }
+        // if so, Next stopped returning solutions before we saw all of them
+        bool BudgetExhausted() const { return m_budgetExhausted; }
+        
+    private:
+        struct Frame {
+            std::unique_ptr<CSP> csp;
+            std::vector<Guess> guesses;
+            std::size_t nextGuess;
+        };
+        
+        // propagates the csp, and either returns it as a solution, drops it
+        // (if invalid), or pushes it to be guessed on
+        std::optional<CompactSolution> Expand(std::unique_ptr<CSP> csp);
+        
+        CspSolver* m_solver;
+        std::vector<Frame> m_frames;
+        bool m_started;
+        SearchStats m_stats;
+        SolveBudget::Clock::time_point m_startTime;
+        bool m_budgetExhausted;
+    };
+    
+    SolutionEnumerator EnumerateSolutions() { return SolutionEnumerator(*this); }
     // SolveSolution SolveStep();
     
-    const std::vector<SolveAttempt>& GetSolutions() const { return m_foundSolutions; }
+    // Narrows down the starting point between solves, without starting over:
+    // the change is also made to the root as far as it was propagated. The
+    // change must not add solutions (e.g. adding a constraint), so learned
+    // nogoods and states known to have no solutions are kept for the next
+    // solve. Returns false if the change failed on the starting point.
+    bool Refine(const std::function<bool(CSP&)>& change);
+    // between solves: the starting point, as far as it was propagated
+    const CSP& Root() const { return *m_working; }
+    // for the next solves
+    void SetBudget(const SolveBudget& budget) { m_options.budget = budget; }
+    
+    const std::vector<FoundSolution>& GetSolutions() const { return m_foundSolutions; }
+    // after SolveUnique or CheckUnique came back NotUnique: the two solutions
+    // that show it (empty otherwise)
+    const std::vector<CompactSolution>& GetWitnesses() const { return m_witnesses; }
+    // the starting point with the values of the solution filled in
+    CSP SolutionCsp(const CompactSolution& values) const;
+    crow::json::wvalue SerializeSolution(const FoundSolution& solution) const;
     
 private:
+    // SolveDeterministic without serialising the solution
+    SolveSolution PropagateWorking();
+    // SolveUnique from the working csp, within the budget already started
+    SolveSolution SolveUniqueWorking();
+    // the steps of RateDifficulty on the root, NotYetSolved when giving up
+    SolveSolution RateWorking(DifficultyRating& rating, unsigned int stopAbove);
+    // tries every possible value of the unsolved cells and removes the ones
+    // for which propagation fails, until every value left survives its probe
+    SolveSolution ProbeWorking();
+    // true if the csp has symmetries to break (and the options ask for it).
+    // The fixed cells get applied to the root when solving.
+    bool BeginSymmetryBreaking();
+    // drops what was learned about the representatives only, keeps the solutions
+    void EndSymmetryBreaking();
+    // false if a symmetry is sure to map the csp to a lexicographically smaller one
+    bool IsLexLeader(const CSP& csp) const;
+    // the number of solutions symmetric to the given solved csp
+    unsigned long NumSymmetricSolutions(const CSP& csp) const;
+    // stores the number of solutions below a fully explored state
+    void RememberState(std::uint64_t stateHash, unsigned long numSolutions);
+    // resets the stats and the clock, called by each entry point
+    void StartBudget();
+    // sets m_budgetExhausted if the budget of the options ran out
+    bool BudgetExhausted();
+    SolveSolution BudgetExhaustedSolution() const;
     // adds on top of the working branch and sets m_working
     void MakeGuess(const Guess& guess);
+    // removes the top of the working branch and resets m_working
+    void PopGuess();
+    // drops the working branch (and found solutions) and starts again from the starting point
+    void ResetWorkingBranch();
+    bool FailureBudgetExhausted() const { return m_failureBudget > 0 && m_numFailures >= m_failureBudget; }
     SolveSolution SolveWorking(bool random, bool checkUnique);
     SolveSolution Solve(bool random);
     
+    // applies the constraints (and learned nogoods) until nothing changes
+    // returns false if the csp turned out to be invalid
+    bool Propagate(CSP& csp, std::shared_ptr<Constraint>& failedConstraint);
+    // nullptr if applying the guesses to the propagated root makes it invalid
+    std::unique_ptr<CSP> PropagateFromRoot(const GuessSequence& guesses);
+    // the guesses of the current branch that are enough to make it invalid
+    GuessSequence ExplainInvalidBranch();
+    // the guesses of the current branch that are enough to rule out every
+    // tried guess, starting from the union of their explanations
+    GuessSequence ExplainExhaustedBranch(
+        const GuessSequence& triedGuessesConflict,
+        const std::vector<Guess>& triedGuesses
+    );
+    
+    SolverOptions m_options;
     std::unique_ptr<CSP> m_startingPoint;
     std::stack<SolveAttempt> m_workingBranch;
     // the top of the working branch
     CSP* m_working;
-    std::vector<SolveAttempt> m_foundSolutions;
+    std::vector<FoundSolution> m_foundSolutions;
+    std::vector<CompactSolution> m_witnesses;
+    
+    std::unique_ptr<NogoodDatabase> m_nogoods;
+    // the starting point after the first deterministic solve
+    std::unique_ptr<CSP> m_propagatedRoot;
+    // set whenever a branch turns out to have no solutions: the guesses which
+    // were enough to rule it out
+    GuessSequence m_conflict;
+    
+    // failed branches in the current run, which is abandoned (NotYetSolved)
+    // once the budget is reached. No budget if 0.
+    unsigned long m_numFailures;
+    unsigned long m_failureBudget;
+    unsigned long m_numRestarts;
+    
+    // when limiting discrepancies, only this many more guesses which are not
+    // the first choice for their cell may be made on the current branch
+    bool m_limitDiscrepancies;
+    unsigned long m_discrepanciesLeft;
+    // how often a guess was skipped because of the limit
+    unsigned long m_numDiscrepancyCutoffs;
+    
+    // when counting, solutions are not stored in m_foundSolutions, and we
+    // only stop early once we reach the limit (if there is one)
+    bool m_countingSolutions;
+    unsigned long m_solutionLimit;
+    // found since the working branch was last reset
+    unsigned long m_numSolutions;
+    SearchStats m_stats;
+    
+    SolveBudget::Clock::time_point m_budgetStart;
+    bool m_budgetExhausted;
+    
+    // give up on branches deeper than m_guessDepthLimit
+    bool m_limitGuessDepth;
+    unsigned int m_guessDepthLimit;
+    // if not empty: the guesses agreeing with this solution are tried last
+    CompactSolution m_avoidSolution;
+    
+    // by (cell key, value): the domains left after the last successful probe.
+    // As long as they are still possible, probing the value again cannot fail.
+    // Missing a removal is always safe, so these are never invalidated.
+    std::map< std::pair<unsigned long, int>, std::vector<std::uint64_t> > m_probeSupports;
+    // fully explored states and their number of solutions
+    std::unique_ptr<TranspositionTable> m_transpositions;
+    
+    // found on first use
+    std::unique_ptr<SymmetryBreaking> m_symmetries;
+    // by symmetry: the key each key is moved from
+    std::vector< std::vector<unsigned long> > m_inverseCellMaps;
+    bool m_breakingSymmetries;
     
     // std::vector< std::shared_ptr<Constraint> >::iterator constraintIt;
 }; // CspSolver
@@ -0,0 +1,63 @@
+//
+//  DomainSizeBuckets.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef DomainSizeBuckets_hpp
+#define DomainSizeBuckets_hpp
+
+#include <vector>
+#include <cstddef>
+
+namespace Csp {
+
+// Keeps track of the unsolved cells of a CSP, bucketed by the number of
+// possible values they have left. Each bucket is a sparse set (dense key array
+// plus a position lookup), so inserting, moving and removing a cell are O(1),
+// and so is finding a cell with the smallest domain (the number of buckets is
+// bounded by the largest domain size, not the number of cells).
+//
+// The structure has value semantics: it is copied along with the CSP when we
+// make a guess, so backtracking (popping the guess) restores it for free.
+class DomainSizeBuckets {
+public:
+    DomainSizeBuckets() = default;
+
+    // domains of size < 2 are solved (or invalid), so those cells are not tracked
+    void Insert(unsigned long key, std::size_t domainSize);
+    // no-op for keys that are not tracked (e.g. while the CSP is being built)
+    void Update(unsigned long key, std::size_t domainSize);
+    void Remove(unsigned long key);
+
+    bool Contains(unsigned long key) const;
+    bool Empty() const { return m_numTracked == 0; }
+    std::size_t Size() const { return m_numTracked; }
+
+    // requires !Empty()
+    unsigned long SmallestDomainKey() const;
+    // all the keys tied for the smallest domain, requires !Empty()
+    const std::vector<unsigned long>& SmallestDomainKeys() const { return m_buckets[m_minBucket]; }
+    std::size_t SmallestDomainSize() const { return m_minBucket; }
+
+private:
+    static constexpr std::size_t kNotTracked = static_cast<std::size_t>(-1);
+
+    void RemoveFromBucket(unsigned long key);
+    void AddToBucket(unsigned long key, std::size_t domainSize);
+    void AdvanceMinBucket();
+
+    // m_buckets[s] holds the keys of the cells with s possible values
+    std::vector< std::vector<unsigned long> > m_buckets;
+    // by key: the bucket the cell is in, and the position within that bucket
+    std::vector<std::size_t> m_bucketOf;
+    std::vector<std::size_t> m_positionIn;
+
+    std::size_t m_minBucket = 0;
+    std::size_t m_numTracked = 0;
+}; // DomainSizeBuckets
+
+} // ::Csp
+
+#endif /* DomainSizeBuckets_hpp */
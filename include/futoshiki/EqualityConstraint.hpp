@@ -62,7 +62,8 @@ public:
 private:
     DISALLOW_COPY_AND_ASSIGN(EqualityConstraint);
     // bool: if the not equal condition turned out to be valid
-    bool EvalMutuallyExclusiveNotEqualConditions();
+    // only looks at groups of up to maxGroupSize cells sharing their possible values
+    bool EvalMutuallyExclusiveNotEqualConditions(std::size_t maxGroupSize);
     bool EvalOnlyOptions(); // this should only be used if the CSP is such that all cells in a not equal group have the same possible values and the number of available possile values = the number of cells in the group, e.g. for a latin square
     
     std::vector< std::weak_ptr<Cell> > m_cells;
@@ -9,6 +9,15 @@
 #define Futoshiki_hpp
 
 #include "LatinSquare.hpp"
+#include "GeneratorOptions.hpp"
+#include "BoardTransform.hpp"
+
+#include <tuple>
+#include <optional>
+
+namespace Utils {
+class ThreadPool;
+}
 
 namespace Csp {
 
@@ -30,11 +39,147 @@ public:
         : LatinSquare(std::move(initCells))
     { };
     
+    // what the generator adds to a puzzle: a given value, or an inequality
+    // between two adjacent cells
+    struct PuzzleConstraint {
+        enum class Type {
+            Given,
+            Inequality,
+        };
+        
+        Type type;
+        // givens only use lhsKey and val
+        unsigned long lhsKey;
+        Constraint::Operator op;
+        unsigned long rhsKey;
+        int val;
+        
+        // values: of every cell, by key
+        bool HoldsFor(const std::vector<std::uint8_t>& values) const;
+    };
+    
+    // refSolution: the values of a solution, by cell key
+    // std::nullopt if every cell is solved already
+    std::optional<PuzzleConstraint> ChooseRandomConstraint(
+        const std::vector<std::uint8_t>& refSolution
+    ) const;
+    // witnesses: other solutions of the puzzle, which the constraint should
+    // rule out (while refSolution stays a solution). Picks from the type of
+    // constraint chosen at random the one ruling out the most witnesses.
+    // std::nullopt if no constraint rules out any
+    std::optional<PuzzleConstraint> ChooseConstraintAgainst(
+        const std::vector<std::uint8_t>& refSolution,
+        const std::vector< std::vector<std::uint8_t> >& witnesses
+    ) const;
+    // also works on a propagated copy of the puzzle
+    // return false if the constraint cannot hold
+    bool ApplyConstraint(const PuzzleConstraint& constraint);
     bool AddRandomConstraint(
-        const Futoshiki& refSolution
+        const std::vector<std::uint8_t>& refSolution
+    );
+    
+    // throws BudgetExhaustedError if it runs out of the budget in the options
+    // (or of attempts at the difficulty), std::invalid_argument if the
+    // difficulty is above kMaxGeneratedDifficulty
+    static Futoshiki Generate(unsigned long size, const GeneratorOptions& options = GeneratorOptions());
+    
+    // the value in the first cell is less than the value in the second (by key)
+    struct Inequality {
+        unsigned long lessKey;
+        unsigned long greaterKey;
+        
+        friend bool operator<(const Inequality& lhs, const Inequality& rhs) {
+            return std::tie(lhs.lessKey, lhs.greaterKey) < std::tie(rhs.lessKey, rhs.greaterKey);
+        }
+    };
+    std::vector<Inequality> Inequalities() const;
+    unsigned long Size() const { return m_size; }
+    
+    // whether the transform maps the puzzle (givens and inequalities) onto itself
+    bool IsSymmetricUnder(const BoardTransform& transform) const;
+    CspSymmetry ToSymmetry(const BoardTransform& transform) const;
+    // the puzzle seen through the transform: the possible values of each cell
+    // and the inequalities move (and the values reverse) with it. Its
+    // solutions are the transformed solutions of this one, so a unique puzzle
+    // gives a unique puzzle without solving anything.
+    Futoshiki Transformed(const BoardTransform& transform) const;
+    // the distinct puzzles the 16 transforms give, this one first (fewer if
+    // the puzzle is symmetric)
+    std::vector<Futoshiki> Variants() const;
+    
+    // The representative of the puzzle among its variants: the one with the
+    // smallest key. Variants of a puzzle share the key and the hash, however
+    // the clues were added, and Transformed(transform) is the representative.
+    struct CanonicalForm {
+        BoardTransform transform;
+        // of the representative: the possible values of every cell (as
+        // GetDomainMasks, with a mask of size / 64 + 1 words per cell), then
+        // the inequalities as sorted (less key, greater key) pairs
+        std::vector<std::uint64_t> key;
+        std::uint64_t hash;
+        
+        // the hash as 16 hex digits, as json numbers lose the low bits
+        crow::json::wvalue Serialize() const;
+    };
+    CanonicalForm Canonicalize() const;
+    
+    // An empty board has every permutation of the values and of the rows as
+    // symmetries: fixing the first row and column leaves the reduced latin
+    // squares. Otherwise, the board transforms that leave the puzzle as is.
+    SymmetryBreaking FindSymmetries() const override;
+    CspSymmetry RandomSymmetry() const override;
+    // runs LocalSearch on the puzzle
+    std::optional< std::vector<std::uint8_t> > SearchLocally(
+        unsigned long maxSteps,
+        const SolveBudget& budget
+    ) const override;
+    
+private:
+    // the constraints the generator could add: givens on unsolved cells and
+    // inequalities which are not obvious yet
+    void CandidateConstraints(
+        const std::vector<std::uint8_t>& refSolution,
+        std::vector<PuzzleConstraint>& givens,
+        std::vector<PuzzleConstraint>& inequalities
+    ) const;
+    
+    // scores up to GeneratorOptions::candidates random constraints (of one
+    // type) on copies of the root, std::nullopt if the root is solved
+    static std::optional<PuzzleConstraint> ChooseBestCandidate(
+        const Futoshiki& root,
+        const std::vector<std::uint8_t>& reference,
+        const GeneratorOptions& options,
+        Utils::ThreadPool& pool,
+        const SolveBudget& budget
+    );
+    
+    // from a fresh reference, std::nullopt if the puzzle missed the difficulty
+    static std::optional<Futoshiki> GenerateAttempt(
+        unsigned long size,
+        const GeneratorOptions& options,
+        SolveBudget::Clock::time_point startTime
+    );
+    
+    // the rest of Generate with GeneratorOptions::incremental
+    static Futoshiki GenerateIncrementally(
+        Futoshiki&& out,
+        const std::vector<std::uint8_t>& reference,
+        const GeneratorOptions& options,
+        SolveBudget::Clock::time_point startTime
+    );
+    
+    // Generate with GenerationStrategy::Subtractive, or with a difficulty:
+    // then clues only go while the puzzle rates at most the difficulty, up to
+    // the first removal reaching it. std::nullopt if none does.
+    static std::optional<Futoshiki> GenerateSubtractively(
+        unsigned long size,
+        const std::vector<std::uint8_t>& reference,
+        const GeneratorOptions& options,
+        SolveBudget::Clock::time_point startTime
     );
     
-    static Futoshiki Generate(unsigned long size);
+    // no inequalities, and every value still possible everywhere
+    bool IsEmptyBoard() const;
 }; // LatinSquare
 
 } // ::Csp
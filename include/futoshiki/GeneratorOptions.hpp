@@ -0,0 +1,99 @@
+//
+//  GeneratorOptions.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef GeneratorOptions_hpp
+#define GeneratorOptions_hpp
+
+#include "SolveBudget.hpp"
+
+#include <optional>
+
+namespace Csp {
+
+// how the generator compares candidate constraints: fewer is better
+enum class CandidateScoring {
+    // the values left possible once the constraint is propagated
+    Propagation,
+    // the solutions left (counted up to a limit), then as Propagation.
+    // Much slower: each count is a small search of its own.
+    SolutionCount,
+};
+
+// how Futoshiki::Generate builds a puzzle
+enum class GenerationStrategy {
+    // add random constraints to the empty board until it is unique
+    Additive,
+    // start from every given and inequality of the reference solution, and
+    // remove them in random order while the puzzle stays unique. Every
+    // remaining clue is needed, but it takes a check per clue.
+    Subtractive,
+};
+
+// the highest GeneratorOptions::difficulty: probing. Puzzles needing guesses
+// are rarely found at all.
+constexpr unsigned int kMaxGeneratedDifficulty = 4;
+
+// Knobs for Futoshiki::Generate. The defaults generate without limits.
+struct GeneratorOptions {
+    // maxTime, the deadline and the cancellation cover the whole generation,
+    // maxNodes applies to each solve along the way. Generate throws
+    // BudgetExhaustedError when it runs out.
+    SolveBudget budget;
+    GenerationStrategy strategy = GenerationStrategy::Additive;
+    
+    // the DifficultyRating::Score the puzzle should have (any if not set): 0
+    // to 3 for the propagation levels, 4 for probing. Generate throws
+    // std::invalid_argument above kMaxGeneratedDifficulty.
+    // Puzzles of a difficulty are always generated subtractively: clues are
+    // removed (givens first, for the propagation levels) while the puzzle
+    // rates at most the difficulty, until it rates exactly that. Generation
+    // starts over from a new reference if no clue can go before then. Hall
+    // sets only pay off on larger boards.
+    std::optional<unsigned int> difficulty;
+    // references to try for the difficulty, before throwing
+    // BudgetExhaustedError. 0 for no limit.
+    unsigned int maxAttempts = 50;
+    // a puzzle only counts as unique once that is proven within this many
+    // nested guesses (0 for no limit). Raising it accepts harder puzzles,
+    // which would otherwise get more constraints added.
+    unsigned int maxGuessDepth = 4;
+    // additive only: skip the uniqueness check while propagation leaves
+    // more than this share of the search space of the empty board (in
+    // log2, so 0.25 is the fourth root of it), and add another constraint
+    // straight away. Unique puzzles hardly ever come close to 0.25. 1 to
+    // always check.
+    double quickFilterSpace = 0.25;
+    // check uniqueness with one solver throughout, which gets each new
+    // constraint added, instead of a fresh solver for every check
+    bool incremental = true;
+    // when a check finds other solutions besides the reference, pick the
+    // next constraints to rule them out, and only check again once they are
+    // all ruled out (incremental only)
+    bool useWitnesses = true;
+    
+    // draw this many random constraints for each one added, score them in
+    // parallel and keep the best (incremental only). 1 keeps the first drawn.
+    unsigned int candidates = 1;
+    CandidateScoring candidateScoring = CandidateScoring::Propagation;
+    // scoring the candidates, or checking removals, 0 for one per hardware thread
+    unsigned int threads = 0;
+    // subtractive only: clues taken out at once, each checked on its own and
+    // all of them together in parallel. Kept out together if that is still
+    // unique. 0 for one per thread.
+    unsigned int removalBatch = 0;
+    
+    // mixing steps of the latin square sampler before taking the reference
+    // solution, 0 for size^2
+    unsigned long mixingSteps = 0;
+    // seed of the reference solution (and of the order the subtractive
+    // generator removes clues in), random if not set
+    std::optional<unsigned int> seed;
+};
+
+} // ::Csp
+
+#endif /* GeneratorOptions_hpp */
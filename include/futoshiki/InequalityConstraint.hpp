@@ -56,6 +56,9 @@ public:
     
     std::vector<std::string> GetCellIds() const final;
     crow::json::wvalue Serialize() const final;
+    
+    unsigned long LhsKey() const;
+    unsigned long RhsKey() const;
 
 private:
     DISALLOW_COPY_AND_ASSIGN(InequalityConstraint);
@@ -0,0 +1,60 @@
+//
+//  LatinSquareSampler.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef LatinSquareSampler_hpp
+#define LatinSquareSampler_hpp
+
+#include <vector>
+#include <random>
+#include <optional>
+#include <cstdint>
+
+namespace Csp {
+
+// Samples (close to) uniformly random latin squares with the Markov chain of
+// Jacobson and Matthews. The square is an n x n x n incidence cube, with a 1
+// at (row, col, value) if the cell holds the value. Each move adds 1 to four
+// entries and takes 1 from four others, so every line of the cube still sums
+// to 1; a move may leave a single -1 behind (an improper square), which the
+// next moves resolve.
+//
+// Only the proper squares are uniform in the limit, so a mixing step runs
+// from one proper square to the next (about size moves on average).
+class LatinSquareSampler {
+public:
+    // 0 mixing steps means size^2
+    explicit LatinSquareSampler(
+        unsigned long size,
+        unsigned long mixingSteps = 0,
+        std::optional<unsigned int> seed = std::nullopt
+    );
+    
+    // the values (1 to size) of the cells in key order, row by row. Each
+    // sample continues the chain from the previous one.
+    std::vector<std::uint8_t> Sample();
+    
+private:
+    std::int8_t& At(unsigned long row, unsigned long col, unsigned long val) {
+        return m_cube[(row * m_size + col) * m_size + val];
+    }
+    // one move of the chain
+    void Step();
+    
+    unsigned long m_size;
+    unsigned long m_mixingSteps;
+    std::vector<std::int8_t> m_cube;
+    // the entry holding -1, if the square is improper
+    bool m_proper;
+    unsigned long m_improperRow;
+    unsigned long m_improperCol;
+    unsigned long m_improperVal;
+    std::mt19937 m_gen;
+}; // LatinSquareSampler
+
+} // ::Csp
+
+#endif /* LatinSquareSampler_hpp */
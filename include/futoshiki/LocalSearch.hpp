@@ -0,0 +1,102 @@
+//
+//  LocalSearch.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef LocalSearch_hpp
+#define LocalSearch_hpp
+
+#include "Futoshiki.hpp"
+#include "SolveBudget.hpp"
+
+#include <vector>
+#include <random>
+#include <optional>
+#include <cstdint>
+
+namespace Csp {
+
+struct LocalSearchOptions {
+    // budget.maxNodes limits the number of moves, like maxSteps
+    SolveBudget budget;
+    unsigned long maxSteps = 1000000;
+    // start again from a fresh random board after this many moves without
+    // improving on the best board of the current run
+    unsigned long restartAfter = 20000;
+    // moves undoing a recent move are forbidden for this many moves,
+    // unless they lead to the best board seen in the run
+    unsigned long tabuTenure = 10;
+    // probability of making a random move instead of the best one
+    double noise = 0.02;
+    // random if not set
+    std::optional<unsigned int> seed;
+};
+
+// Tabu search over complete boards, for puzzles which are expected to have a
+// solution (e.g. a board with few givens). Rows are kept as permutations of
+// the values, so only the columns, the inequalities and the possible values
+// of the cells can be violated. A move swaps two cells of a row, and the
+// violations are counted incrementally.
+//
+// Not finding a solution within the budget says nothing about whether the
+// puzzle has one.
+class LocalSearch {
+public:
+    explicit LocalSearch(const Futoshiki& puzzle, const LocalSearchOptions& options = LocalSearchOptions());
+
+    struct Result {
+        bool found;
+        // the values of the cells in key order, if found
+        std::vector<std::uint8_t> values;
+        unsigned long steps;
+        unsigned long restarts;
+        // violations left on the best board, 0 if found
+        unsigned long bestCost;
+        bool budgetExhausted;
+    };
+
+    Result Run();
+
+private:
+    struct Move {
+        unsigned long row;
+        unsigned long lhsCol;
+        unsigned long rhsCol;
+        long delta;
+    };
+
+    unsigned long Key(unsigned long row, unsigned long col) const { return row * m_size + col; }
+    // false if the givens of a row clash, then no board satisfies the rows
+    bool RandomBoard();
+    long Cost() const;
+    // cost of the inequalities and possible values around the two cells, as if
+    // they held the given values
+    long LocalCost(unsigned long row, unsigned long lhsCol, int lhsVal, unsigned long rhsCol, int rhsVal) const;
+    long SwapDelta(unsigned long row, unsigned long lhsCol, unsigned long rhsCol) const;
+    void Swap(unsigned long row, unsigned long lhsCol, unsigned long rhsCol);
+    bool IsConflicted(unsigned long row, unsigned long col) const;
+    std::optional<Move> ChooseMove(long cost, long bestCost);
+
+    LocalSearchOptions m_options;
+    unsigned long m_size;
+    std::vector<std::uint64_t> m_domains; // by key, as GetDomainMasks
+    std::vector<bool> m_fixed; // by key, cells with a single possible value
+    std::vector<Futoshiki::Inequality> m_inequalities;
+    // by key: the inequalities the cell takes part in
+    std::vector< std::vector<std::size_t> > m_inequalitiesOf;
+
+    std::vector<int> m_values; // by key
+    // by column and value: how often the value appears in the column
+    std::vector< std::vector<unsigned long> > m_colCounts;
+    // by key and value: the step until which putting the value back is tabu
+    std::vector< std::vector<unsigned long> > m_tabuUntil;
+    unsigned long m_step;
+
+    std::mt19937 m_gen;
+}; // LocalSearch
+
+} // ::Csp
+
+#endif /* LocalSearch_hpp */
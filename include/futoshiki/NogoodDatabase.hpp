@@ -0,0 +1,85 @@
+//
+//  NogoodDatabase.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef NogoodDatabase_hpp
+#define NogoodDatabase_hpp
+
+#include "ConstraintSatisfactionProblem.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace Csp {
+
+// A bounded store of nogoods: sets of guesses which cannot all hold in any
+// solution. Each nogood watches two of its guesses which are not (yet) true.
+// Only when a watched guess becomes true do we look at the rest of the
+// nogood: either we find a new guess to watch, or all but one guess hold and
+// the last one gets refuted (or all hold and the branch is invalid).
+//
+// Watches never need to be restored when backtracking: a guess which is not
+// true deeper in the search is not true higher up either.
+class NogoodDatabase {
+public:
+    using Nogood = std::vector<Guess>;
+
+    explicit NogoodDatabase(std::size_t capacity);
+
+    static constexpr std::size_t kNotStored = static_cast<std::size_t>(-1);
+    
+    // permanent nogoods are never evicted
+    // returns the index of the stored nogood (kNotStored if it was not stored)
+    std::size_t Add(const Nogood& nogood, bool permanent = false);
+    void Remove(std::size_t nogoodIdx);
+    void Clear();
+
+    // looks at the nogoods watching guesses on the given cells
+    // return false if a nogood is violated (or refuting a guess made the csp invalid)
+    bool Propagate(ConstraintSatisfactionProblem& csp, const std::vector<unsigned long>& changedCells);
+    // looks at every nogood, e.g. for a freshly built csp
+    bool PropagateAll(ConstraintSatisfactionProblem& csp);
+
+    std::size_t Size() const { return m_numStored; }
+    unsigned long NumPropagations() const { return m_numPropagations; }
+
+private:
+    struct StoredNogood {
+        Nogood guesses;
+        std::size_t watches[2];
+        unsigned long hits; // how often this nogood refuted a guess or found a conflict
+        unsigned long addedAt;
+        bool permanent;
+        bool alive;
+    };
+
+    enum class Outcome {
+        Watching, // found an undecided guess to watch
+        Refuted,
+        Satisfied,
+        Violated,
+    };
+
+    // called when the guess watched in the given slot became true
+    Outcome Visit(ConstraintSatisfactionProblem& csp, std::size_t nogoodIdx, int watchSlot);
+    void Watch(std::size_t nogoodIdx, int watchSlot, std::size_t guessIdx);
+    static bool WatchesCell(const StoredNogood& stored, unsigned long cellKey);
+    std::size_t EvictionCandidate() const;
+
+    std::size_t m_capacity;
+    std::vector<StoredNogood> m_nogoods;
+    std::vector<std::size_t> m_freeSlots;
+    // by cell key: the nogoods that watch a guess on that cell. Entries of
+    // evicted nogoods (or watches that moved) are dropped lazily.
+    std::vector< std::vector<std::size_t> > m_watchers;
+    std::size_t m_numStored;
+    unsigned long m_numAdded;
+    unsigned long m_numPropagations;
+}; // NogoodDatabase
+
+} // ::Csp
+
+#endif /* NogoodDatabase_hpp */
@@ -0,0 +1,50 @@
+//
+//  PropagationLevel.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef PropagationLevel_hpp
+#define PropagationLevel_hpp
+
+namespace Csp {
+
+// How much the constraints deduce on their own, weakest first. Each level
+// also makes the deductions of the ones before it.
+enum class PropagationLevel {
+    // only the bounds the inequalities put on each other
+    Bounds,
+    // a solved cell rules its value out for the other cells of the group
+    NakedSingles,
+    // a value possible in only one cell of the group goes there
+    HiddenSingles,
+    // k cells of the group with the same k possible values rule them out for
+    // the other cells (naked pairs, triples, ...)
+    HallSets,
+};
+
+constexpr PropagationLevel kPropagationLevels[] = {
+    PropagationLevel::Bounds,
+    PropagationLevel::NakedSingles,
+    PropagationLevel::HiddenSingles,
+    PropagationLevel::HallSets,
+};
+
+inline const char* PropagationLevelName(PropagationLevel level) {
+    switch (level) {
+        case PropagationLevel::Bounds:
+            return "bounds";
+        case PropagationLevel::NakedSingles:
+            return "naked singles";
+        case PropagationLevel::HiddenSingles:
+            return "hidden singles";
+        case PropagationLevel::HallSets:
+            return "hall sets";
+    }
+    return "";
+}
+
+} // ::Csp
+
+#endif /* PropagationLevel_hpp */
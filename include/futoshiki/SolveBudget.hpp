@@ -0,0 +1,55 @@
+//
+//  SolveBudget.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef SolveBudget_hpp
+#define SolveBudget_hpp
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+namespace Csp {
+
+// Lets another thread ask a running solve to stop. The solver checks it at
+// every node, so it stops soon after, with BudgetExhausted.
+class CancellationToken {
+public:
+    void Cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool IsCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+    
+private:
+    std::atomic<bool> m_cancelled{false};
+}; // CancellationToken
+
+// Limits on a single solve. Zero means no limit.
+struct SolveBudget {
+    using Clock = std::chrono::steady_clock;
+    
+    unsigned long maxNodes = 0;
+    std::chrono::milliseconds maxTime = std::chrono::milliseconds::zero();
+    // unlike maxTime, not restarted by the next solve: one deadline covers
+    // every solve of e.g. a request
+    std::optional<Clock::time_point> deadline;
+    std::shared_ptr<const CancellationToken> cancellation;
+    
+    bool Unlimited() const { return maxNodes == 0 && maxTime.count() == 0 && !deadline && !cancellation; }
+    // nodes: the csps looked at since the solve started at startTime,
+    // including the one we are about to look at
+    bool Exhausted(unsigned long nodes, Clock::time_point startTime) const;
+};
+
+// thrown by the generator, which cannot return a partial puzzle
+class BudgetExhaustedError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+} // ::Csp
+
+#endif /* SolveBudget_hpp */
@@ -0,0 +1,89 @@
+//
+//  SolverOptions.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef SolverOptions_hpp
+#define SolverOptions_hpp
+
+#include "SolveBudget.hpp"
+#include "PropagationLevel.hpp"
+
+#include <cstddef>
+
+namespace Csp {
+
+enum class RestartPolicy {
+    None,
+    // restart after unit * luby(i) failed branches: 1, 1, 2, 1, 1, 2, 4, 1, ...
+    Luby,
+};
+
+enum class BranchingScheme {
+    // one branch per possible value of the cell: x = v1 | x = v2 | ...
+    Enumerate,
+    // x = v | x != v, the refutation is propagated before guessing again
+    Binary,
+    // x <= mid | x > mid, which suits the bounds reasoning of inequalities
+    DomainSplit,
+};
+
+// Knobs for CspSolver. The defaults reproduce the plain depth first search.
+struct SolverOptions {
+    // record the guesses responsible for a failed branch as nogoods, and
+    // backjump over guesses that did not contribute to the failure
+    bool learnNogoods = false;
+    // least useful nogoods are evicted once the database is full
+    std::size_t maxNogoods = 2000;
+    
+    // only used by SolveRandom: each restart reshuffles the guesses, and
+    // learned nogoods are kept across restarts
+    RestartPolicy restartPolicy = RestartPolicy::None;
+    // failed branches per step of the restart sequence
+    unsigned long restartUnit = 32;
+    
+    // note the guess depth (and the limit on it when solving uniquely) counts
+    // every branching decision, so binary schemes need more depth
+    BranchingScheme branching = BranchingScheme::Enumerate;
+    
+    // SolveUnique and CheckUnique give up (GuessDepthExceeded) on branches
+    // needing more nested guesses than this, 0 for no limit
+    unsigned int maxGuessDepth = 4;
+    // SolveUnique retries with a limit of 0, 1, 2, ... up to maxGuessDepth, and
+    // reports the shallowest depth that settled the puzzle as "provingDepth"
+    bool iterativeDeepening = false;
+    
+    // what the constraints deduce on their own: weaker levels leave more to
+    // probing and guessing
+    PropagationLevel propagationLevel = PropagationLevel::HallSets;
+    
+    // singleton consistency (failed literal probing) on the nodes less than
+    // this many guesses deep, so 1 only probes the root and 0 never probes:
+    // each possible value is tried on a copy and removed if propagation fails
+    unsigned int probeDepth = 0;
+    
+    // slots for fully explored states, so states reached again through other
+    // guess orders are not explored twice. Each holds the possible values of
+    // every cell (8 bytes per cell). 0 disables the table.
+    std::size_t transpositionTableSize = 0;
+    
+    // CountSolutions and SolveRandom only search one solution out of each
+    // class of symmetric solutions the csp knows of (counting weighs it by the
+    // size of its class, SolveRandom maps it by a random symmetry)
+    bool breakSymmetries = false;
+    
+    // Solve first runs a local search of this many moves on the starting
+    // point (Futoshiki only, see LocalSearch), and only searches the tree if
+    // it finds no solution. Pays off on puzzles which surely have solutions,
+    // e.g. large boards with a few givens. 0 to go straight to the tree.
+    unsigned long localSearchSteps = 0;
+    
+    // applies to each call of a solve entry point, apart from the deadline
+    SolveBudget budget;
+};
+
+} // ::Csp
+
+#endif /* SolverOptions_hpp */
@@ -0,0 +1,66 @@
+//
+//  TranspositionTable.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef TranspositionTable_hpp
+#define TranspositionTable_hpp
+
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+namespace Csp {
+
+// A bounded cache of the number of solutions of search states we explored
+// fully. Different guess orders often propagate to the same state, and the
+// state (the possible values of every cell) is all that decides what is
+// below it.
+//
+// States are hashed Zobrist style: the xor of a fixed random key per
+// (cell, possible value). The table has a fixed number of slots, a new entry
+// replaces whatever was in its slot. Entries keep the full state, so a hash
+// collision is never mistaken for a hit.
+class TranspositionTable {
+public:
+    // the possible values of every cell as bitmasks, in key order
+    using DomainMasks = std::vector<std::uint64_t>;
+    
+    // a capacity of 0 stores nothing
+    explicit TranspositionTable(std::size_t capacity);
+    
+    // the key of a possible value of a cell: Hash is the xor of these, so a
+    // hash can be kept up to date by xoring out the values removed
+    static std::uint64_t Key(std::uint64_t cellIdx, std::uint64_t val);
+    static std::uint64_t Hash(const DomainMasks& domains);
+    
+    // false if Lookup is sure to miss, so the state need not be built
+    bool MayHold(std::uint64_t hash) const;
+    // the number of solutions below the state, if we know it
+    std::optional<unsigned long> Lookup(std::uint64_t hash, const DomainMasks& domains) const;
+    void Store(std::uint64_t hash, const DomainMasks& domains, unsigned long numSolutions);
+    // keeps the states without solutions, e.g. once a constraint is added: it
+    // can only remove solutions
+    void DropSolutionCounts();
+    void Clear();
+    
+    std::size_t Size() const { return m_numStored; }
+    
+private:
+    struct Entry {
+        std::uint64_t hash = 0;
+        DomainMasks domains; // empty if the slot is free
+        unsigned long numSolutions = 0;
+    };
+    
+    std::size_t m_capacity;
+    std::vector<Entry> m_entries; // allocated on the first store
+    std::size_t m_numStored;
+}; // TranspositionTable
+
+} // ::Csp
+
+#endif /* TranspositionTable_hpp */
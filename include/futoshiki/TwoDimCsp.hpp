@@ -72,8 +72,8 @@ public:
     unsigned long m_numCols;
 
 protected:
-    bool ValidCoords(const CellCoords& cords);
-    unsigned long CoordsToIndex(const CellCoords& cords);
+    bool ValidCoords(const CellCoords& cords) const;
+    unsigned long CoordsToIndex(const CellCoords& cords) const;
     
 private:
     std::vector< std::vector< std::weak_ptr<Cell> > > GetGrid() const;
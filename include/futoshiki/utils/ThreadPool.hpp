@@ -0,0 +1,61 @@
+//
+//  ThreadPool.hpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace Utils {
+
+// A fixed set of worker threads taking tasks off a shared queue.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned int numThreads = 0);
+    // finishes the queued tasks first
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // the future holds the result (or the exception) of the task
+    template <typename Task>
+    auto Submit(Task&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared< std::packaged_task<Result()> >(std::forward<Task>(task));
+        auto out = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        m_wakeUp.notify_one();
+        return out;
+    }
+    
+    std::size_t Size() const { return m_workers.size(); }
+    
+private:
+    void Work();
+    
+    std::vector<std::thread> m_workers;
+    std::queue< std::function<void()> > m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping;
+}; // ThreadPool
+
+} // ::Utils
+
+#endif /* ThreadPool_hpp */
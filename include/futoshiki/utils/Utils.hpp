@@ -141,6 +141,9 @@ std::vector<T> FlattenVector2d(const std::vector<std::vector<T>>& v) {
 // generate set sequence like 1, 2, 3, ..., size
 std::set<int> GenSetSequence(unsigned long size);
 
+// i-th (from 1) term of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+unsigned long Luby(unsigned long i);
+
 template<typename Iter, typename RandomGenerator>
 Iter SelectRandomly(Iter start, Iter end, RandomGenerator& g) {
     std::uniform_int_distribution<long> dis(0, std::distance(start, end) - 1);
@@ -150,8 +153,8 @@ Iter SelectRandomly(Iter start, Iter end, RandomGenerator& g) {
 
 template<typename Iter>
 Iter SelectRandomly(Iter start, Iter end) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
+    static thread_local std::random_device rd;
+    static thread_local std::mt19937 gen(rd());
     return SelectRandomly(start, end, gen);
 }
 
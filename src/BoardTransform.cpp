@@ -0,0 +1,64 @@
+//
+//  BoardTransform.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/BoardTransform.hpp>
+
+#include <futoshiki/Cell.hpp>
+
+#include <utility>
+
+namespace Csp {
+
+std::vector<BoardTransform> BoardTransform::All() {
+    std::vector<BoardTransform> out;
+    for (int bits = 0; bits < 16; ++bits) {
+        BoardTransform transform;
+        transform.transpose = bits & 1;
+        transform.flipRows = bits & 2;
+        transform.flipCols = bits & 4;
+        transform.reverseValues = bits & 8;
+        out.push_back(transform);
+    }
+    return out;
+}
+
+TwoDimCsp::CellCoords BoardTransform::Apply(const TwoDimCsp::CellCoords& coords, unsigned long size) const {
+    auto out = coords;
+    if (transpose) {
+        std::swap(out.first, out.second);
+    }
+    if (flipRows) {
+        out.second = size - 1 - out.second;
+    }
+    if (flipCols) {
+        out.first = size - 1 - out.first;
+    }
+    return out;
+}
+
+unsigned long BoardTransform::ApplyToKey(unsigned long key, unsigned long size) const {
+    auto coords = Apply({key % size, key / size}, size);
+    return coords.second * size + coords.first;
+}
+
+int BoardTransform::ApplyToValue(int val, unsigned long size) const {
+    if (!reverseValues || val == Cell::kUnsolvedSymbol) {
+        return val;
+    }
+    return static_cast<int>(size) + 1 - val;
+}
+
+crow::json::wvalue BoardTransform::Serialize() const {
+    auto out = crow::json::wvalue();
+    out["transpose"] = transpose;
+    out["flipRows"] = flipRows;
+    out["flipCols"] = flipCols;
+    out["reverseValues"] = reverseValues;
+    return out;
+}
+
+} // ::Csp
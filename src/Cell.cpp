@@ -16,9 +16,10 @@
 
 namespace Csp {
 
-Cell::Cell(int initVal, const std::string& id, const std::set<int>& possibleValues, ConstraintSatisfactionProblem* csp)
+Cell::Cell(int initVal, const std::string& id, const std::set<int>& possibleValues, ConstraintSatisfactionProblem* csp, unsigned long key)
     : m_val(kUnsolvedSymbol) // set using SetIfPossible bellow
     , m_id(id)
+    , m_key(key)
     , m_possibleValues() // set below depending on if the cell is set
     , m_appliedConstraints()
     , m_csp(csp)
@@ -36,6 +37,7 @@ Cell::Cell(int initVal, const std::string& id, const std::set<int>& possibleValu
 Cell::Cell(const crow::json::rvalue& cellJson)
     : m_val(kUnsolvedSymbol) // set using SetIfPossible bellow
     , m_id()
+    , m_key(0) // set once the cell is added to a csp
     , m_possibleValues() // set below depending on if the cell is set
     , m_appliedConstraints()
     , m_csp(nullptr)
@@ -96,8 +98,13 @@ Cell::Cell(const crow::json::rvalue& cellJson)
 }
 
 Cell::Cell(const Cell& other, ConstraintSatisfactionProblem* newCsp)
+    : Cell(other, other.m_key, newCsp)
+{ }
+
+Cell::Cell(const Cell& other, unsigned long key, ConstraintSatisfactionProblem* newCsp)
     : m_val(other.m_val)
     , m_id(other.m_id)
+    , m_key(key)
     , m_possibleValues(other.m_possibleValues)
     , m_appliedConstraints(other.m_appliedConstraints)
     , m_csp(newCsp)
@@ -143,7 +150,11 @@ bool Cell::EnforceLessThan(int lessThanThis) {
     }
     
     if (rit != m_possibleValues.rbegin()) {
+        for (auto it = rit.base(); it != m_possibleValues.end(); ++it) {
+            ReportValueRemoved(*it);
+        }
         m_possibleValues.erase(rit.base(), m_possibleValues.end());
+        ReportDomainChange();
         
         if (m_possibleValues.size() == 0) {
             VLOG(2) << "Cannot enforce less than " << lessThanThis;
@@ -175,7 +186,11 @@ bool Cell::EnforceGreaterThan(int greaterThanThis) {
     }
     
     if (it != m_possibleValues.begin()) {
+        for (auto removedIt = m_possibleValues.begin(); removedIt != it; ++removedIt) {
+            ReportValueRemoved(*removedIt);
+        }
         m_possibleValues.erase(m_possibleValues.begin(), it);
+        ReportDomainChange();
         
         if (m_possibleValues.size() == 0) {
             VLOG(2) << "Cannot enforce greater than " << greaterThanThis;
@@ -193,7 +208,14 @@ bool Cell::EnforceGreaterThan(int greaterThanThis) {
 std::pair<bool, bool> Cell::EliminateVals(const std::set<int>& toRemove) {
     bool removedAny = false;
     for (auto val : toRemove) {
-        removedAny |= m_possibleValues.erase(val) > 0;
+        if (m_possibleValues.erase(val) > 0) {
+            ReportValueRemoved(val);
+            removedAny = true;
+        }
+    }
+    
+    if (removedAny) {
+        ReportDomainChange();
     }
     
     if (m_possibleValues.empty()) {
@@ -212,8 +234,14 @@ void Cell::SetVal(const int val) {
     assertm(m_possibleValues.find(val) != m_possibleValues.end(),
             "should only set to a value which is possible");
     
+    for (auto removed : m_possibleValues) {
+        if (removed != val) {
+            ReportValueRemoved(removed);
+        }
+    }
     m_possibleValues.clear();
     m_possibleValues.insert(val);
+    ReportDomainChange();
     
     SetIfPossible();
     ReportChangeToConstraints();
@@ -243,6 +271,18 @@ bool Cell::SetIfPossible() {
     return false;
 }
 
+void Cell::ReportDomainChange() const {
+    if (m_csp) {
+        m_csp->ReportCellDomainChanged(m_key, m_possibleValues.size());
+    }
+}
+
+void Cell::ReportValueRemoved(int val) const {
+    if (m_csp) {
+        m_csp->ReportCellValueRemoved(m_key, val);
+    }
+}
+
 void Cell::ReportChangeToConstraints() {
     for (auto& constraint : m_appliedConstraints) {
         constraint.lock()->ReportChanged();
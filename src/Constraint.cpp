@@ -45,6 +45,7 @@ void Constraint::ReportChanged() {
     assertm(!m_solved, "cells changed, but constraint was already marked as solved\n");
     const bool previouslyActive = IsActive();
     m_relatedCellsChanged = true;
+    m_changedWhileApplying = true;
     if (SetSolvedIfPossible()) {
         if (previouslyActive) {
             ReportBecameInactive();
@@ -9,6 +9,7 @@
 
 #include <futoshiki/Constraint.hpp>
 #include <futoshiki/Cell.hpp>
+#include <futoshiki/TranspositionTable.hpp>
 
 #include <futoshiki/utils/Utils.hpp>
 
@@ -21,6 +22,7 @@
 #include <cassert>
 #include <sstream>
 #include <random>
+#include <cmath>
 
 namespace Csp {
 
@@ -37,6 +39,8 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
     , m_defaultPossibleValues(defaultPossibleValues)
     , m_cells()
     , m_constraints()
+    , m_propagationLevel(PropagationLevel::HallSets)
+    , m_domainHash(0)
 {
     for (auto [cellIdx, initValue] : Utils::enumerate(initValues)) {
         m_cells.emplace(
@@ -46,11 +50,13 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
                     initValue,
                     std::to_string(cellIdx),
                     m_defaultPossibleValues,
-                    this
+                    this,
+                    cellIdx
                 )
             )
         );
     }
+    InitUnsolvedCells();
 }
 
 ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
@@ -66,6 +72,8 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
     , m_defaultPossibleValues(defaultPossibleValues)
     , m_cells()
     , m_constraints()
+    , m_propagationLevel(PropagationLevel::HallSets)
+    , m_domainHash(0)
 {
     for (auto [cellIdx, initValue] : Utils::enumerate(initValues)) {
         m_cells.emplace(
@@ -75,11 +83,13 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
                     initValue.second,
                     initValue.first,
                     m_defaultPossibleValues,
-                    this
+                    this,
+                    cellIdx
                 )
             )
         );
     }
+    InitUnsolvedCells();
 }
 
 ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
@@ -94,6 +104,8 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
     , m_defaultPossibleValues()
     , m_cells()
     , m_constraints()
+    , m_propagationLevel(PropagationLevel::HallSets)
+    , m_domainHash(0)
 {
     for (auto [cellIdx, initCell] : Utils::enumerate(initCells)) {
         if (initCell.IsSolved()) {
@@ -102,10 +114,11 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(
         m_cells.emplace(
             std::make_pair(
                 cellIdx,
-                std::make_shared<Cell>(initCell, this)
+                std::make_shared<Cell>(initCell, cellIdx, this)
             )
         );
     }
+    InitUnsolvedCells();
 }
 
 ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(const ConstraintSatisfactionProblem& other)
@@ -118,6 +131,10 @@ ConstraintSatisfactionProblem::ConstraintSatisfactionProblem(const ConstraintSat
     , m_defaultPossibleValues(other.m_defaultPossibleValues)
     , m_cells()
     , m_constraints()
+    , m_unsolvedCells(other.m_unsolvedCells)
+    , m_changedCells(other.m_changedCells)
+    , m_propagationLevel(other.m_propagationLevel)
+    , m_domainHash(other.m_domainHash)
 {
     // shallow copy all the cells to begin with
     for (auto& cell : other.m_cells) {
@@ -190,6 +207,10 @@ ConstraintSatisfactionProblem& ConstraintSatisfactionProblem::operator =(const C
     m_completelySolved = other.m_completelySolved;
     m_numCells = other.m_numCells;
     m_defaultPossibleValues = other.m_defaultPossibleValues;
+    m_unsolvedCells = other.m_unsolvedCells;
+    m_changedCells = other.m_changedCells;
+    m_propagationLevel = other.m_propagationLevel;
+    m_domainHash = other.m_domainHash;
     
     // shallow copy all the cells to begin with
     for (auto& cell : other.m_cells) {
@@ -375,6 +396,63 @@ unsigned long ConstraintSatisfactionProblem::FindCellIdx(const std::string& cell
 }
 
 
+GuessState ConstraintSatisfactionProblem::EvaluateGuess(const Guess& guess) const {
+    const auto& cell = m_cells.at(guess.cellKey);
+    const auto& possibleVals = cell->GetPossibleValuesRef();
+    if (possibleVals.empty()) {
+        return GuessState::False;
+    }
+    switch (guess.type) {
+        case Guess::Type::Assign:
+            if (cell->IsSolved()) {
+                return cell->Value() == guess.val ? GuessState::True : GuessState::False;
+            }
+            return possibleVals.count(guess.val) ? GuessState::Undecided : GuessState::False;
+        case Guess::Type::LessEqual:
+            if (*possibleVals.rbegin() <= guess.val) {
+                return GuessState::True;
+            }
+            return *possibleVals.begin() <= guess.val ? GuessState::Undecided : GuessState::False;
+        case Guess::Type::Exclude:
+        case Guess::Type::Greater:
+            switch (EvaluateGuess(guess.Negated())) {
+                case GuessState::True: return GuessState::False;
+                case GuessState::False: return GuessState::True;
+                case GuessState::Undecided: return GuessState::Undecided;
+            }
+    }
+    return GuessState::Undecided;
+}
+
+bool ConstraintSatisfactionProblem::ApplyGuess(const Guess& guess) {
+    switch (EvaluateGuess(guess)) {
+        case GuessState::True:
+            return true;
+        case GuessState::False:
+            return false;
+        case GuessState::Undecided:
+            break;
+    }
+    
+    auto& cell = m_cells.at(guess.cellKey);
+    switch (guess.type) {
+        case Guess::Type::Assign:
+            cell->SetVal(guess.val);
+            return true;
+        case Guess::Type::Exclude:
+            return cell->EliminateVals({guess.val}).first;
+        case Guess::Type::LessEqual:
+            return cell->EnforceLessThan(guess.val + 1);
+        case Guess::Type::Greater:
+            return cell->EnforceGreaterThan(guess.val);
+    }
+    return false;
+}
+
+bool ConstraintSatisfactionProblem::RefuteGuess(const Guess& guess) {
+    return ApplyGuess(guess.Negated());
+}
+
 void ConstraintSatisfactionProblem::ReportIfCellNewlySolved() {
     ++m_numSolvedCells;
     
@@ -386,6 +464,31 @@ void ConstraintSatisfactionProblem::ReportIfCellNewlySolved() {
     }
 }
 
+void ConstraintSatisfactionProblem::ReportCellDomainChanged(unsigned long cellKey, std::size_t domainSize) {
+    m_unsolvedCells.Update(cellKey, domainSize);
+    m_changedCells.push_back(cellKey);
+}
+
+void ConstraintSatisfactionProblem::ReportCellValueRemoved(unsigned long cellKey, int val) {
+    m_domainHash ^= TranspositionTable::Key(cellKey, static_cast<std::uint64_t>(val));
+}
+
+std::vector<unsigned long> ConstraintSatisfactionProblem::TakeChangedCells() {
+    std::vector<unsigned long> out;
+    std::swap(out, m_changedCells);
+    return out;
+}
+
+void ConstraintSatisfactionProblem::InitUnsolvedCells() {
+    m_unsolvedCells = DomainSizeBuckets();
+    for (const auto& [cellKey, cell] : m_cells) {
+        if (!cell->IsSolved()) {
+            m_unsolvedCells.Insert(cellKey, cell->GetPossibleValuesRef().size());
+        }
+    }
+    m_domainHash = TranspositionTable::Hash(GetDomainMasks());
+}
+
 void ConstraintSatisfactionProblem::ReportIfConstraintNewlySolved() {
     ++m_numSolvedConstraints;
     
@@ -430,30 +533,46 @@ void Csp::MakeGuess(const Guess& guess) {
 
 // our heuristic here is to just chose all of the possible values
 // for the cell with the lowest number of possible values
-std::vector<Guess> ConstraintSatisfactionProblem::GetGuesses(bool random) const {
+std::vector<Guess> ConstraintSatisfactionProblem::GetGuesses(bool random, BranchingScheme scheme) const {
+    assertm(!m_unsolvedCells.Empty(), "should only guess if there are unsolved cells");
     
-    auto remainingCellKeys = RemainingCellKeys();
-    
-    std::sort(
-        remainingCellKeys.begin(),
-        remainingCellKeys.end(),
-        [&](unsigned int i, unsigned int j){
-            return m_cells.at(i)->GetPossibleValuesRef().size() > m_cells.at(j)->GetPossibleValuesRef().size();
-        }
-    );
-    
-    auto chosenCellKey = remainingCellKeys.front();
+    // break ties randomly as well, so restarts do not keep picking the same cells
+    auto chosenCellKey = random
+        ? *Utils::SelectRandomly(m_unsolvedCells.SmallestDomainKeys().begin(), m_unsolvedCells.SmallestDomainKeys().end())
+        : m_unsolvedCells.SmallestDomainKey();
     auto& possibleVals = m_cells.at(chosenCellKey)->GetPossibleValuesRef();
     
-    std::vector<Guess> outGuesses(possibleVals.size());
-    std::transform(
-        possibleVals.begin(),
-        possibleVals.end(),
-        outGuesses.begin(),
-        [chosenCellKey](const int possibleVal) -> Guess {
-            return {chosenCellKey, possibleVal};
+    std::vector<Guess> outGuesses;
+    switch (scheme) {
+        case BranchingScheme::Enumerate:
+            outGuesses.resize(possibleVals.size());
+            std::transform(
+                possibleVals.begin(),
+                possibleVals.end(),
+                outGuesses.begin(),
+                [chosenCellKey](const int possibleVal) -> Guess {
+                    return {chosenCellKey, possibleVal};
+                }
+            );
+            break;
+        case BranchingScheme::Binary: {
+            auto val = random
+                ? *Utils::SelectRandomly(possibleVals.begin(), possibleVals.end())
+                : *possibleVals.begin();
+            Guess guess{chosenCellKey, val};
+            outGuesses = {guess, guess.Negated()};
+            // the value is already random, keep the refutation second
+            random = false;
+            break;
         }
-    );
+        case BranchingScheme::DomainSplit: {
+            // lower half (rounded up) first
+            auto mid = *std::next(possibleVals.begin(), static_cast<long>((possibleVals.size() - 1) / 2));
+            Guess guess{chosenCellKey, mid, Guess::Type::LessEqual};
+            outGuesses = {guess, guess.Negated()};
+            break;
+        }
+    }
     
     if (random) {
         std::shuffle(
@@ -480,6 +599,65 @@ std::vector<unsigned long> ConstraintSatisfactionProblem::RemainingCellKeys() co
     return remainingCellKeys;
 }
 
+std::vector<std::uint8_t> ConstraintSatisfactionProblem::CompactValues() const {
+    std::vector<std::uint8_t> out;
+    out.reserve(m_cells.size());
+    for (const auto& [key, cell] : m_cells) {
+        assertm(Utils::CanTypeFitValue<std::uint8_t>(cell->Value()), "cell values should fit into a byte");
+        out.push_back(static_cast<std::uint8_t>(cell->Value()));
+    }
+    return out;
+}
+
+bool ConstraintSatisfactionProblem::AssignCompactValues(const std::vector<std::uint8_t>& values) {
+    assertm(values.size() == m_cells.size(), "should have a value for every cell");
+    auto valueIt = values.begin();
+    for (const auto& [key, cell] : m_cells) {
+        auto val = *valueIt++;
+        if (val != Cell::kUnsolvedSymbol && !ApplyGuess({key, val})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ConstraintSatisfactionProblem::DomainMasks ConstraintSatisfactionProblem::GetDomainMasks() const {
+    DomainMasks out;
+    out.reserve(m_cells.size());
+    for (const auto& [key, cell] : m_cells) {
+        std::uint64_t mask = 0;
+        for (auto val : cell->GetPossibleValuesRef()) {
+            if (val < 0 || val >= 64) {
+                return {};
+            }
+            mask |= std::uint64_t(1) << val;
+        }
+        out.push_back(mask);
+    }
+    return out;
+}
+
+double ConstraintSatisfactionProblem::Log2SearchSpace() const {
+    double out = 0;
+    for (const auto& [key, cell] : m_cells) {
+        out += std::log2(static_cast<double>(cell->GetPossibleValuesRef().size()));
+    }
+    return out;
+}
+
+void ConstraintSatisfactionProblem::SetPropagationLevel(PropagationLevel level) {
+    const bool raised = level > m_propagationLevel;
+    m_propagationLevel = level;
+    if (!raised) {
+        return;
+    }
+    for (auto& constraint : m_constraints) {
+        if (!constraint->IsSolved() && !constraint->IsActive()) {
+            constraint->ReportChanged();
+        }
+    }
+}
+
 crow::json::wvalue ConstraintSatisfactionProblem::Serialize() const {
     return SerializeCsp();
 }
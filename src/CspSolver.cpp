@@ -9,70 +9,305 @@
 
 #include <futoshiki/ConstraintSatisfactionProblem.hpp>
 #include <futoshiki/Futoshiki.hpp>
+#include <futoshiki/NogoodDatabase.hpp>
+#include <futoshiki/TranspositionTable.hpp>
 
+#include <futoshiki/utils/Utils.hpp>
 #include <futoshiki/utils/easylogging++.h>
 
+#include <algorithm>
+#include <limits>
+
 namespace Csp {
 
 template <typename CSP>
-CspSolver<CSP, EnableIfPolicy<CSP>>::CspSolver(CSP&& startingPoint)
-    : m_startingPoint(std::make_unique<CSP>(startingPoint))
+CspSolver<CSP, EnableIfPolicy<CSP>>::CspSolver(CSP&& startingPoint, const SolverOptions& options)
+    : m_options(options)
+    , m_startingPoint(std::make_unique<CSP>(startingPoint))
     , m_workingBranch()
     , m_working()
     , m_foundSolutions()
+    , m_witnesses()
+    , m_nogoods(std::make_unique<NogoodDatabase>(options.maxNogoods))
+    , m_propagatedRoot()
+    , m_conflict()
+    , m_numFailures(0)
+    , m_failureBudget(0)
+    , m_numRestarts(0)
+    , m_limitDiscrepancies(false)
+    , m_discrepanciesLeft(0)
+    , m_numDiscrepancyCutoffs(0)
+    , m_countingSolutions(false)
+    , m_solutionLimit(0)
+    , m_numSolutions(0)
+    , m_stats()
+    , m_budgetStart(SolveBudget::Clock::now())
+    , m_budgetExhausted(false)
+    , m_limitGuessDepth(false)
+    , m_guessDepthLimit(0)
+    , m_avoidSolution()
+    , m_probeSupports()
+    , m_transpositions(std::make_unique<TranspositionTable>(options.transpositionTableSize))
+    , m_symmetries()
+    , m_inverseCellMaps()
+    , m_breakingSymmetries(false)
 {
-    SolveAttempt initialWorking;
-    initialWorking.csp = std::make_unique<CSP>(startingPoint);
-    
-    m_workingBranch.push(std::move(initialWorking));
-    m_working = m_workingBranch.top().csp.get();
+    m_startingPoint->SetPropagationLevel(m_options.propagationLevel);
+    ResetWorkingBranch();
 }
 
+// defined here, where NogoodDatabase is a complete type
 template <typename CSP>
-typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
-CspSolver<CSP, EnableIfPolicy<CSP>>::SolveDeterministic() {
-    VLOG(2) << "Starting deterministic solve ";
-    while(m_working->m_numActiveConstraints > 0) {
-        for (auto& constraint : m_working->m_constraints) {
-            if (constraint->IsActive()) {
-                if(!constraint->Apply()) {
-                    VLOG(2) << "Constraint turned out to be invalid";
-                    return {
-                        false,
-                        false,
-                        {SolveSolution::ReasonType::ConstraintCannotBeSatisfied, constraint->Serialize()}
-                    }; // invalid
+CspSolver<CSP, EnableIfPolicy<CSP>>::~CspSolver() = default;
+
+template <typename CSP>
+bool CspSolver<CSP, EnableIfPolicy<CSP>>::Propagate(CSP& csp, std::shared_ptr<Constraint>& failedConstraint) {
+    while (true) {
+        while(csp.m_numActiveConstraints > 0) {
+            for (auto& constraint : csp.m_constraints) {
+                if (constraint->IsActive()) {
+                    if(!constraint->Apply()) {
+                        failedConstraint = constraint;
+                        return false;
+                    }
                 }
             }
         }
+        
+        // the nogoods can only refute guesses on cells that changed
+        auto changedCells = csp.TakeChangedCells();
+        if (m_nogoods->Size() == 0 || changedCells.empty()) {
+            break;
+        }
+        if (!m_nogoods->Propagate(csp, changedCells)) {
+            VLOG(2) << "Learned nogood was violated";
+            return false;
+        }
     }
     
-    for (auto& constraint : m_working->m_constraints) {
+    for (auto& constraint : csp.m_constraints) {
         if (constraint->ShouldStillCheckValid()) {
             if(!constraint->Valid()) {
-                VLOG(2) << "Constraint turned out to be invalid";
-                return {
-                    false,
-                    false,
-                    {SolveSolution::ReasonType::ConstraintCannotBeSatisfied, constraint->Serialize()}
-                }; // invalid
+                failedConstraint = constraint;
+                return false;
             }
             constraint->SetChecked();
         }
     }
+    return true;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolveDeterministic() {
+    auto res = PropagateWorking();
+    if (res.completeSolve) {
+        crow::json::wvalue solutionsJson;
+        solutionsJson[0] =  m_working->Serialize();
+        res.reason.details["solutions"] = std::move(solutionsJson);
+    }
+    return res;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::PropagateWorking() {
+    VLOG(2) << "Starting deterministic solve ";
+    std::shared_ptr<Constraint> failedConstraint;
+    if (!Propagate(*m_working, failedConstraint)) {
+        VLOG(2) << "Constraint turned out to be invalid";
+        return {
+            false,
+            false,
+            {
+                SolveSolution::ReasonType::ConstraintCannotBeSatisfied,
+                failedConstraint ? failedConstraint->Serialize() : crow::json::wvalue()
+            }
+        }; // invalid
+    }
     
     VLOG(2) << "Finished deterministic solve (" << (m_working->m_completelySolved ? "SOLVED" : "UNSOLVED") << ")";
     m_working->m_provenValid = true;
-    crow::json::wvalue reasonJson;
-    if (m_working->m_completelySolved) {
-        crow::json::wvalue solutionsJson;
-        solutionsJson[0] =  m_working->Serialize();
-        reasonJson["solutions"] = std::move(solutionsJson);
+    return {
+        m_working->m_completelySolved,
+        m_working->m_provenValid,
+        {SolveSolution::ReasonType::ManagedToSolve, {} }
+    };
+}
+
+namespace {
+
+// whether every value possible in subset is still possible in domains
+bool IsSubsetOf(const std::vector<std::uint64_t>& subset, const std::vector<std::uint64_t>& domains) {
+    if (subset.empty() || subset.size() != domains.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < subset.size(); ++i) {
+        if ((subset[i] & ~domains[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // ::
+
+template <typename CSP>
+bool CspSolver<CSP, EnableIfPolicy<CSP>>::BeginSymmetryBreaking() {
+    if (!m_options.breakSymmetries) {
+        return false;
+    }
+    if (!m_symmetries) {
+        m_symmetries = std::make_unique<SymmetryBreaking>(m_startingPoint->FindSymmetries());
+        for (const auto& symmetry : m_symmetries->symmetries) {
+            std::vector<unsigned long> inverse(symmetry.cellMap.size());
+            for (unsigned long key = 0; key < symmetry.cellMap.size(); ++key) {
+                inverse[symmetry.cellMap[key]] = key;
+            }
+            m_inverseCellMaps.push_back(std::move(inverse));
+        }
+        VLOG(1) << "Found " << m_symmetries->symmetries.size() << " symmetries and "
+            << m_symmetries->fixedCells.size() << " cells to fix";
+    }
+    if (m_symmetries->Empty()) {
+        return false;
+    }
+    
+    m_breakingSymmetries = true;
+    // the stored counts are of all the solutions, not the representatives
+    m_transpositions->DropSolutionCounts();
+    return true;
+}
+
+template <typename CSP>
+void CspSolver<CSP, EnableIfPolicy<CSP>>::EndSymmetryBreaking() {
+    m_breakingSymmetries = false;
+    m_nogoods->Clear();
+    m_transpositions->Clear();
+    m_propagatedRoot.reset();
+    
+    // the root has the fixed cells applied
+    auto solutions = std::move(m_foundSolutions);
+    auto numSolutions = m_numSolutions;
+    ResetWorkingBranch();
+    m_foundSolutions = std::move(solutions);
+    m_numSolutions = numSolutions;
+}
+
+template <typename CSP>
+bool CspSolver<CSP, EnableIfPolicy<CSP>>::IsLexLeader(const CSP& csp) const {
+    for (std::size_t symmetryIdx = 0; symmetryIdx < m_symmetries->symmetries.size(); ++symmetryIdx) {
+        const auto& symmetry = m_symmetries->symmetries[symmetryIdx];
+        const auto& inverse = m_inverseCellMaps[symmetryIdx];
+        // compare the values with the values of the image, cell by cell
+        for (unsigned long key = 0; key < inverse.size(); ++key) {
+            const auto& own = csp.m_cells.at(key)->GetPossibleValuesRef();
+            int imageMin = std::numeric_limits<int>::max();
+            int imageMax = std::numeric_limits<int>::min();
+            for (auto val : csp.m_cells.at(inverse[key])->GetPossibleValuesRef()) {
+                auto mapped = symmetry.MapValue(val);
+                imageMin = std::min(imageMin, mapped);
+                imageMax = std::max(imageMax, mapped);
+            }
+            if (*own.rbegin() < imageMin) {
+                break; // smaller than the image
+            }
+            if (*own.begin() > imageMax) {
+                return false;
+            }
+            if (own.size() > 1 || imageMin != imageMax) {
+                break; // undecided as yet
+            }
+        }
+    }
+    return true;
+}
+
+template <typename CSP>
+unsigned long CspSolver<CSP, EnableIfPolicy<CSP>>::NumSymmetricSolutions(const CSP& csp) const {
+    // the symmetries that map the solution onto itself make up a subgroup
+    auto values = csp.CompactValues();
+    unsigned long numFixing = 1;
+    for (const auto& symmetry : m_symmetries->symmetries) {
+        if (symmetry.Apply(values) == values) {
+            ++numFixing;
+        }
+    }
+    return (m_symmetries->symmetries.size() + 1) / numFixing * m_symmetries->fixedCellsMultiplier;
+}
+
+template <typename CSP>
+void CspSolver<CSP, EnableIfPolicy<CSP>>::RememberState(
+    std::uint64_t stateHash,
+    unsigned long numSolutions
+) {
+    // while a solution is excluded (see CheckUnique) the counts are not those
+    // of the actual problem
+    if (!m_avoidSolution.empty()) {
+        return;
+    }
+    m_transpositions->Store(stateHash, m_working->GetDomainMasks(), numSolutions);
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::ProbeWorking() {
+    bool removedAny = true;
+    while (removedAny) {
+        removedAny = false;
+        auto domains = m_working->GetDomainMasks();
+        for (auto cellKey : m_working->RemainingCellKeys()) {
+            auto& cell = m_working->m_cells.at(cellKey);
+            if (cell->IsSolved()) {
+                continue; // solved by an earlier removal
+            }
+            
+            const auto values = cell->GetPossibleValuesRef();
+            bool removedFromCell = false;
+            for (auto val : values) {
+                auto supportIt = m_probeSupports.find({cellKey, val});
+                if (supportIt != m_probeSupports.end() && IsSubsetOf(supportIt->second, domains)) {
+                    continue;
+                }
+                if (BudgetExhausted()) {
+                    return BudgetExhaustedSolution();
+                }
+                
+                ++m_stats.probes;
+                CSP probe(*m_working);
+                std::shared_ptr<Constraint> failedConstraint;
+                if (probe.ApplyGuess({cellKey, val}) && Propagate(probe, failedConstraint)) {
+                    m_probeSupports[{cellKey, val}] = probe.GetDomainMasks();
+                    continue;
+                }
+                
+                VLOG(3) << "Probing cell " << cellKey << " with " << val << " failed";
+                ++m_stats.probeRemovals;
+                removedFromCell = true;
+                if (!m_working->RefuteGuess({cellKey, val})) {
+                    return {
+                        false,
+                        false,
+                        {SolveSolution::ReasonType::ConstraintCannotBeSatisfied, {} }
+                    };
+                }
+            }
+            
+            if (removedFromCell) {
+                removedAny = true;
+                auto res = PropagateWorking();
+                if (!res.valid || res.completeSolve) {
+                    return res;
+                }
+                domains = m_working->GetDomainMasks();
+            }
+        }
     }
+    
     return {
         m_working->m_completelySolved,
         m_working->m_provenValid,
-        {SolveSolution::ReasonType::ManagedToSolve, std::move(reasonJson)}
+        {SolveSolution::ReasonType::ManagedToSolve, {} }
     };
 }
 
@@ -80,9 +315,53 @@ template <typename CSP>
 typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
 CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique) {
     auto depthGuess = m_workingBranch.size() - 1;
+    ++m_stats.nodes;
+    if (BudgetExhausted()) {
+        return BudgetExhaustedSolution();
+    }
+    
+    // nogoods learned in earlier runs can already rule out values at the root
+    if (depthGuess == 0 && m_nogoods->Size() > 0 && !m_nogoods->PropagateAll(*m_working)) {
+        VLOG(2) << "Learned nogoods rule out the starting point";
+        m_conflict.clear();
+        return {
+            false,
+            false,
+            {SolveSolution::ReasonType::NoGuessesWorked, {} }
+        };
+    }
+    
+    // leaves one solution out of each class of symmetric solutions
+    if (depthGuess == 0 && m_breakingSymmetries) {
+        for (const auto& guess : m_symmetries->fixedCells) {
+            if (!m_working->ApplyGuess(guess)) {
+                VLOG(2) << "Cannot fix the cells that break the symmetries";
+                m_conflict.clear();
+                return {
+                    false,
+                    false,
+                    {SolveSolution::ReasonType::NoGuessesWorked, {} }
+                };
+            }
+        }
+    }
     
     // Try to solve as is
-    auto deterministicRes = SolveDeterministic();
+    auto deterministicRes = PropagateWorking();
+    if (deterministicRes.valid && !deterministicRes.completeSolve && depthGuess < m_options.probeDepth) {
+        deterministicRes = ProbeWorking();
+        if (deterministicRes.reason.reasonType == SolveSolution::ReasonType::BudgetExhausted) {
+            return deterministicRes;
+        }
+    }
+    if (deterministicRes.valid && m_breakingSymmetries && !IsLexLeader(*m_working)) {
+        VLOG(2) << "A symmetric branch comes first";
+        deterministicRes = {
+            false,
+            false,
+            {SolveSolution::ReasonType::ConstraintCannotBeSatisfied, {} }
+        };
+    }
     if (!deterministicRes.valid) {
         if (depthGuess > 0) {
             auto& lastGuess = m_workingBranch.top().seq.back();
@@ -92,10 +371,38 @@ CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique
         else {
             VLOG(2) << "Guess {}" << " (" << depthGuess << ") was not valid";
         }
+        
+        if (m_options.learnNogoods) {
+            m_conflict = ExplainInvalidBranch();
+            m_nogoods->Add(m_conflict);
+        }
+        
+        ++m_numFailures;
+        ++m_stats.failures;
+        if (depthGuess > 0 && FailureBudgetExhausted()) {
+            VLOG(2) << "Failure budget of " << m_failureBudget << " exhausted. Abandoning run.";
+            return {
+                false,
+                false,
+                {SolveSolution::ReasonType::NotYetSolved, {} }
+            };
+        }
         return deterministicRes;
     }
+    // propagation can take a while on big boards, so check again at the fixpoint
+    if (BudgetExhausted()) {
+        return BudgetExhaustedSolution();
+    }
+    if (depthGuess == 0 && m_options.learnNogoods) {
+        m_propagatedRoot = std::make_unique<CSP>(*m_working);
+    }
     if (deterministicRes.completeSolve) {
-        m_foundSolutions.push_back( m_workingBranch.top() );
+        if (m_countingSolutions) {
+            m_numSolutions += m_breakingSymmetries ? NumSymmetricSolutions(*m_working) : 1;
+            return deterministicRes;
+        }
+        ++m_numSolutions;
+        m_foundSolutions.push_back({ m_working->CompactValues(), m_workingBranch.top().seq });
         
         if (depthGuess > 0) {
             auto& lastGuess = m_workingBranch.top().seq.back();
@@ -105,39 +412,93 @@ CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique
         else {
             VLOG(2) << "Guess {}" << " (" << depthGuess << ") produced solution";
         }
-        deterministicRes.reason.details["solutions"][0]["requiredGuessDepth"] = depthGuess;
         return deterministicRes;
     }
     
+    // other guess orders may have led to this state before (the hash is kept
+    // by the csp, the state itself is only built to confirm a likely hit)
+    const auto stateHash = m_working->DomainHash();
+    if (m_options.transpositionTableSize > 0 && m_transpositions->MayHold(stateHash)) {
+        auto knownSolutions = m_transpositions->Lookup(stateHash, m_working->GetDomainMasks());
+        if (knownSolutions && *knownSolutions == 0) {
+            VLOG(2) << "State already known to have no solutions (" << depthGuess << ")";
+            ++m_stats.transpositionHits;
+            // (the guesses that led here are the only explanation we have)
+            m_conflict = m_workingBranch.top().seq;
+            return {
+                false,
+                false,
+                {SolveSolution::ReasonType::NoGuessesWorked, {} }
+            };
+        }
+        // only counting can use the number of solutions, the other modes
+        // need the solutions themselves
+        if (knownSolutions && m_countingSolutions
+            && (m_solutionLimit == 0 || m_numSolutions + *knownSolutions < m_solutionLimit)
+        ) {
+            VLOG(2) << "State already known to have " << *knownSolutions << " solutions (" << depthGuess << ")";
+            ++m_stats.transpositionHits;
+            m_numSolutions += *knownSolutions;
+            return { true, true, {SolveSolution::ReasonType::ManagedToSolve, {} } };
+        }
+    }
+    
     // Require guess
     ++depthGuess;
     VLOG(2) << "Require guess. Depth to " << depthGuess;
-    if (checkUnique && depthGuess > kMaxGuessDepth) {
+    if (m_limitGuessDepth && depthGuess > m_guessDepthLimit) {
         VLOG(2) << "Require guess, but max guess depth exceeded: "
-                  << depthGuess << "/" << kMaxGuessDepth << ".";
+                  << depthGuess << "/" << m_guessDepthLimit << ".";
+        crow::json::wvalue reasonJson;
+        reasonJson["maxGuessDepth"] = m_guessDepthLimit;
         return {
             false,
             false,
-            {SolveSolution::ReasonType::GuessDepthExceeded, {} }
+            {SolveSolution::ReasonType::GuessDepthExceeded, std::move(reasonJson) }
         };
     }
     
-    auto guesses = m_working->GetGuesses(random);
-    for (auto guess : guesses) {
+    auto guesses = m_working->GetGuesses(random, m_options.branching);
+    if (!m_avoidSolution.empty()) {
+        const auto avoidVal = m_avoidSolution.at(guesses.front().cellKey);
+        std::stable_partition(guesses.begin(), guesses.end(),
+            [avoidVal](const Guess& guess) { return !guess.HoldsFor(avoidVal); }
+        );
+    }
+    const auto numSolutionsBefore = m_numSolutions;
+    const auto numCutoffsBefore = m_numDiscrepancyCutoffs;
+    // the union of the explanations of the branches without solutions
+    GuessSequence triedGuessesConflict;
+    for (unsigned long guessIdx = 0; guessIdx < guesses.size(); ++guessIdx) {
+        const auto& guess = guesses[guessIdx];
+        bool discrepancy = m_limitDiscrepancies && guessIdx > 0;
+        if (discrepancy && m_discrepanciesLeft == 0) {
+            VLOG(2) << "Discrepancy limit reached, skipping remaining guesses (" << depthGuess << ")";
+            ++m_numDiscrepancyCutoffs;
+            break;
+        }
+        
         VLOG(2) << "Trying Guess " << guess.Serialize().dump()
             << " (" << depthGuess << ")";
         
+        if (discrepancy) {
+            --m_discrepanciesLeft;
+        }
         MakeGuess(guess); // Updates the working csp
         auto branchRes = SolveWorking(random, checkUnique);
-        m_workingBranch.pop();
+        PopGuess();
+        if (discrepancy) {
+            ++m_discrepanciesLeft;
+        }
 
-        // if this is the case then we do not bother searching further
-        if (checkUnique && !branchRes.valid) {
-            if (branchRes.reason.reasonType == SolveSolution::ReasonType::GuessDepthExceeded) {
-                return branchRes;
+        if (branchRes.completeSolve) {
+            if (m_countingSolutions) {
+                if (m_solutionLimit > 0 && m_numSolutions >= m_solutionLimit) {
+                    VLOG(2) << "Reached the limit of " << m_solutionLimit << " solutions (" << depthGuess << ")";
+                    return branchRes;
+                }
+                continue;
             }
-        }
-        else if (branchRes.completeSolve) {
             if (!checkUnique) {
                 return branchRes;
             }
@@ -145,8 +506,9 @@ CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique
             if (m_foundSolutions.size() > 1) {
                 VLOG(2) << "Found two solutions. Not unique (" << depthGuess << ")";
                 crow::json::wvalue reasonJson;
-                reasonJson[0] = m_foundSolutions.front().csp->Serialize();
-                reasonJson[1] = m_foundSolutions.back().csp->Serialize();
+                reasonJson[0] = SerializeSolution(m_foundSolutions.front());
+                reasonJson[1] = SerializeSolution(m_foundSolutions.back());
+                m_witnesses = {m_foundSolutions.front().values, m_foundSolutions.back().values};
                 m_foundSolutions.pop_back();
                 m_foundSolutions.pop_back();
                 return {
@@ -155,22 +517,64 @@ CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique
                     {SolveSolution::ReasonType::NotUnique, std::move(reasonJson) }
                 };
             }
+            continue;
+        }
+        
+        // if this is the case then we do not bother searching further
+        if (branchRes.reason.reasonType == SolveSolution::ReasonType::GuessDepthExceeded
+            || branchRes.reason.reasonType == SolveSolution::ReasonType::NotUnique
+            || branchRes.reason.reasonType == SolveSolution::ReasonType::NotYetSolved
+            || branchRes.reason.reasonType == SolveSolution::ReasonType::BudgetExhausted
+        ) {
+            return branchRes;
+        }
+        
+        // the branch has no solutions
+        if (m_options.learnNogoods) {
+            bool guessContributed = std::find(m_conflict.begin(), m_conflict.end(), guess) != m_conflict.end();
+            if (!guessContributed) {
+                assertm(m_numSolutions == numSolutionsBefore, "branch with solutions cannot be ruled out by earlier guesses");
+                VLOG(2) << "Branch ruled out by earlier guesses, backjumping (" << depthGuess << ")";
+                return branchRes;
+            }
+            for (const auto& conflictGuess : m_conflict) {
+                if (!(conflictGuess == guess)) {
+                    triedGuessesConflict.push_back(conflictGuess);
+                }
+            }
         }
     }
 
-    // assertm(checkUnique, "should not have gotten to this point when not checking uniqueness");
-    if (m_foundSolutions.size() > 0) {
-        assertm(m_foundSolutions.size() == 1, "should not get to this point with more than one solution");
+    // every guess below here was tried (and none returned early)
+    if (m_options.transpositionTableSize > 0 && m_numDiscrepancyCutoffs == numCutoffsBefore) {
+        // (m_working is the csp of this node again, the guesses were made on copies)
+        RememberState(stateHash, m_numSolutions - numSolutionsBefore);
+    }
+    
+    if (m_numSolutions > numSolutionsBefore && m_countingSolutions) {
+        VLOG(2) << "Found " << m_numSolutions - numSolutionsBefore << " solutions (" << depthGuess << ")";
+        return { true, true, {SolveSolution::ReasonType::ManagedToSolve, {} } };
+    }
+    if (m_numSolutions > numSolutionsBefore) {
+        assertm(m_numSolutions == numSolutionsBefore + 1, "should not get to this point with more than one solution");
         VLOG(2) << "Found only one solution. Proven unique (" << depthGuess << ")";
-        crow::json::wvalue reasonJson;
-        crow::json::wvalue solutionsJson;
-        solutionsJson[0] =  m_foundSolutions.front().csp->Serialize();
-        solutionsJson[0]["requiredGuessDepth"] = depthGuess;
-        reasonJson["solutions"] = std::move(solutionsJson);
-        return { true, true, {SolveSolution::ReasonType::ManagedToSolve, std::move(reasonJson)} };
+        return { true, true, {SolveSolution::ReasonType::ManagedToSolve, {} } };
+    }
+    
+    if (m_numDiscrepancyCutoffs > numCutoffsBefore) {
+        // not every guess below here was tried, so nothing is proven: the
+        // whole branch is the only safe explanation
+        VLOG(2) << "No guesses worked within the discrepancy limit.";
+        m_conflict = m_workingBranch.top().seq;
+    }
+    else {
+        VLOG(2) << "No guesses worked. Proven invalid.";
+    }
+    if (m_options.learnNogoods && m_numDiscrepancyCutoffs == numCutoffsBefore) {
+        m_conflict = ExplainExhaustedBranch(triedGuessesConflict, guesses);
+        m_nogoods->Add(m_conflict);
     }
     
-    VLOG(2) << "No guesses worked. Proven invalid.";
     crow::json::wvalue reasonJson;
     size_t numGuesses = guesses.size();
     for (unsigned int i = 0; i < numGuesses; ++i) {
@@ -183,19 +587,156 @@ CspSolver<CSP, EnableIfPolicy<CSP> >::SolveWorking(bool random, bool checkUnique
     };
 }
 
+template <typename CSP>
+std::unique_ptr<CSP> CspSolver<CSP, EnableIfPolicy<CSP>>::PropagateFromRoot(const GuessSequence& guesses) {
+    auto csp = std::make_unique<CSP>(*m_propagatedRoot);
+    for (const auto& guess : guesses) {
+        if (!csp->ApplyGuess(guess)) {
+            return nullptr;
+        }
+    }
+    std::shared_ptr<Constraint> failedConstraint;
+    if (!Propagate(*csp, failedConstraint)) {
+        return nullptr;
+    }
+    return csp;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::GuessSequence
+CspSolver<CSP, EnableIfPolicy<CSP>>::ExplainInvalidBranch() {
+    const auto& branch = m_workingBranch.top().seq;
+    GuessSequence conflict = branch;
+    if (!m_propagatedRoot || branch.size() < 2) {
+        return conflict;
+    }
+    
+    // the last guess is needed, otherwise we would have failed one level up.
+    // Try dropping the others, most recent first: the older the guesses we keep,
+    // the further back we can jump.
+    for (auto idx = branch.size() - 1; idx-- > 0;) {
+        GuessSequence candidate;
+        std::copy_if(conflict.begin(), conflict.end(), std::back_inserter(candidate),
+            [&branch, idx](const Guess& guess) { return !(guess == branch[idx]); }
+        );
+        if (!PropagateFromRoot(candidate)) {
+            conflict = std::move(candidate);
+        }
+    }
+    
+    VLOG(2) << "Explained invalid branch with " << conflict.size() << "/" << branch.size() << " guesses";
+    return conflict;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::GuessSequence
+CspSolver<CSP, EnableIfPolicy<CSP>>::ExplainExhaustedBranch(
+    const GuessSequence& triedGuessesConflict,
+    const std::vector<Guess>& triedGuesses
+) {
+    const auto& branch = m_workingBranch.top().seq;
+    if (!m_propagatedRoot || branch.empty()) {
+        return branch;
+    }
+    
+    // a guess and its negation cover every value between them, so the union
+    // of their explanations already rules out the branch
+    if (triedGuesses.size() == 2 && triedGuesses[1] == triedGuesses[0].Negated()) {
+        GuessSequence conflict;
+        for (const auto& guess : branch) {
+            if (std::find(triedGuessesConflict.begin(), triedGuessesConflict.end(), guess) != triedGuessesConflict.end()) {
+                conflict.push_back(guess);
+            }
+        }
+        VLOG(2) << "Explained exhausted branch with " << conflict.size() << "/" << branch.size() << " guesses";
+        return conflict;
+    }
+    
+    const auto cellKey = triedGuesses.front().cellKey;
+    
+    auto inConflict = std::vector<bool>(branch.size());
+    for (unsigned long idx = 0; idx < branch.size(); ++idx) {
+        inConflict[idx] = std::find(triedGuessesConflict.begin(), triedGuessesConflict.end(), branch[idx])
+            != triedGuessesConflict.end();
+    }
+    
+    // The tried guesses were all of the possible values of the cell in this
+    // branch. The explanations of the tried guesses only cover the values that
+    // were possible, so we also need the guesses that removed the other
+    // values. Add the oldest guesses first, until that is the case.
+    while (true) {
+        GuessSequence conflict;
+        for (unsigned long idx = 0; idx < branch.size(); ++idx) {
+            if (inConflict[idx]) {
+                conflict.push_back(branch[idx]);
+            }
+        }
+        
+        auto csp = PropagateFromRoot(conflict);
+        if (!csp) {
+            return conflict;
+        }
+        const auto& possibleVals = csp->m_cells.at(cellKey)->GetPossibleValuesRef();
+        bool allTried = std::all_of(possibleVals.begin(), possibleVals.end(),
+            [&triedGuesses, cellKey](int val) {
+                return std::find(triedGuesses.begin(), triedGuesses.end(), Guess{cellKey, val}) != triedGuesses.end();
+            }
+        );
+        if (allTried) {
+            VLOG(2) << "Explained exhausted branch with " << conflict.size() << "/" << branch.size() << " guesses";
+            return conflict;
+        }
+        
+        auto notYetIn = std::find(inConflict.begin(), inConflict.end(), false);
+        if (notYetIn == inConflict.end()) {
+            return branch;
+        }
+        *notYetIn = true;
+    }
+}
+
 template <typename CSP>
 typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
 CspSolver<CSP, EnableIfPolicy<CSP>>::SolveRandom() {
     LOG(INFO) << "Solving randomly...";
+    StartBudget();
+    const bool breakingSymmetries = BeginSymmetryBreaking();
+    m_numRestarts = 0;
+    // a bad early guess can leave us stuck in a large subtree without
+    // solutions, so give up on runs that fail too often and reshuffle
+    if (m_options.restartPolicy == RestartPolicy::Luby) {
+        m_failureBudget = m_options.restartUnit * Utils::Luby(m_numRestarts + 1);
+        m_numFailures = 0;
+    }
     auto res = SolveWorking(true, false);
+    if (m_options.restartPolicy == RestartPolicy::Luby) {
+        while (res.reason.reasonType == SolveSolution::ReasonType::NotYetSolved) {
+            ++m_numRestarts;
+            ResetWorkingBranch();
+            m_failureBudget = m_options.restartUnit * Utils::Luby(m_numRestarts + 1);
+            m_numFailures = 0;
+            VLOG(1) << "Restart " << m_numRestarts << " with a budget of " << m_failureBudget << " failures";
+            res = SolveWorking(true, false);
+        }
+        m_failureBudget = 0;
+    }
+    if (breakingSymmetries) {
+        if (res.completeSolve) {
+            auto& values = m_foundSolutions.front().values;
+            values = m_startingPoint->RandomSymmetry().Apply(values);
+        }
+        EndSymmetryBreaking();
+    }
     if (!res.valid) {
         LOG(INFO) << "Finished solving. Not valid";
         LOG(INFO) << res;
     }
     if (res.completeSolve) {
         LOG(INFO) << "Finished solving. Found solution.";
-        res.reason.details["requiredGuessDepth"] = m_foundSolutions.front().seq.size();
+        res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.front());
+        res.reason.details["requiredGuessDepth"] = m_foundSolutions.front().guesses.size();
     }
+    res.reason.details["restarts"] = m_numRestarts;
     return res;
 }
 
@@ -203,12 +744,28 @@ template <typename CSP>
 typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
 CspSolver<CSP, EnableIfPolicy<CSP>>::Solve() {
     LOG(INFO) << "Solving...";
+    StartBudget();
+    if (m_options.localSearchSteps > 0) {
+        // the moves are limited by localSearchSteps, not the nodes of the budget
+        auto localBudget = m_options.budget;
+        localBudget.maxNodes = 0;
+        auto values = m_startingPoint->SearchLocally(m_options.localSearchSteps, localBudget);
+        if (values) {
+            LOG(INFO) << "Finished solving. Local search found a solution.";
+            ++m_numSolutions;
+            m_foundSolutions.push_back({std::move(*values), {}});
+            SolveSolution res {true, true, {SolveSolution::ReasonType::ManagedToSolve, {} }};
+            res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.back());
+            return res;
+        }
+    }
     auto res = SolveWorking(false, false);
     if (!res.valid) {
         LOG(INFO) << res;
     }
     if (res.completeSolve) {
         LOG(INFO) << "Finished solving. Found solution.";
+        res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.front());
     }
     return res;
 }
@@ -217,26 +774,443 @@ template <typename CSP>
 typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
 CspSolver<CSP, EnableIfPolicy<CSP>>::SolveUnique() {
     LOG(INFO) << "Solving uniquely...";
+    StartBudget();
+    return SolveUniqueWorking();
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolveUniqueWorking() {
+    m_witnesses.clear();
+    if (!m_options.iterativeDeepening) {
+        m_limitGuessDepth = m_options.maxGuessDepth > 0;
+        m_guessDepthLimit = m_options.maxGuessDepth;
+        auto res = SolveWorking(false, true);
+        m_limitGuessDepth = false;
+        if (!res.valid) {
+            LOG(INFO) << res;
+        }
+        else if (res.completeSolve) {
+            LOG(INFO) << "Finished solving. Found solution.";
+            res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.front());
+            res.reason.details["requiredGuessDepth"] = m_foundSolutions.front().guesses.size();
+        }
+        return res;
+    }
+    
+    // no branch can need more guesses than there are cells
+    const unsigned int maxDepth = m_options.maxGuessDepth > 0
+        ? m_options.maxGuessDepth
+        : static_cast<unsigned int>(m_startingPoint->m_cells.size());
+    m_limitGuessDepth = true;
+    m_guessDepthLimit = 0;
     auto res = SolveWorking(false, true);
+    while (res.reason.reasonType == SolveSolution::ReasonType::GuessDepthExceeded
+           && m_guessDepthLimit < maxDepth
+    ) {
+        ++m_guessDepthLimit;
+        VLOG(1) << "Guess depth exceeded. Deepening to " << m_guessDepthLimit;
+        // the search is back at the (propagated) root, and the nogoods
+        // learned from fully explored branches still hold
+        m_foundSolutions.clear();
+        m_numSolutions = 0;
+        res = SolveWorking(false, true);
+    }
+    m_limitGuessDepth = false;
+    
     if (!res.valid) {
         LOG(INFO) << res;
     }
-    else if (res.completeSolve) {
-        LOG(INFO) << "Finished solving. Found solution.";
-        res.reason.details["requiredGuessDepth"] = m_foundSolutions.front().seq.size();
+    if (res.reason.reasonType != SolveSolution::ReasonType::GuessDepthExceeded
+        && res.reason.reasonType != SolveSolution::ReasonType::BudgetExhausted
+    ) {
+        res.reason.details["provingDepth"] = m_guessDepthLimit;
+    }
+    if (res.completeSolve) {
+        LOG(INFO) << "Finished solving. Found solution at depth " << m_guessDepthLimit << ".";
+        res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.front());
+        res.reason.details["requiredGuessDepth"] = m_foundSolutions.front().guesses.size();
     }
     return res;
 }
 
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::CheckUnique() {
+    LOG(INFO) << "Checking uniqueness...";
+    StartBudget();
+    m_witnesses.clear();
+    m_limitGuessDepth = m_options.maxGuessDepth > 0;
+    m_guessDepthLimit = m_options.maxGuessDepth;
+    auto res = SolveWorking(false, false);
+    if (!res.completeSolve) {
+        m_limitGuessDepth = false;
+        LOG(INFO) << res;
+        return res;
+    }
+    auto first = m_foundSolutions.front();
+    
+    // any other solution differs from the first in one of the cells we did not start with
+    NogoodDatabase::Nogood differ;
+    unsigned long cellIdx = 0;
+    for (const auto& [key, cell] : m_startingPoint->m_cells) {
+        if (!cell->IsSolved()) {
+            differ.push_back({key, first.values.at(cellIdx)});
+        }
+        ++cellIdx;
+    }
+    
+    // (if every cell was given, there is nothing else to find)
+    auto secondRes = SolveSolution{ false, false, {SolveSolution::ReasonType::NoGuessesWorked, {} } };
+    if (!differ.empty()) {
+        VLOG(1) << "Found a first solution. Looking for a different one";
+        // the search is back at the root, which is already propagated
+        m_foundSolutions.clear();
+        m_numSolutions = 0;
+        auto differIdx = m_nogoods->Add(differ, true);
+        m_avoidSolution = first.values;
+        secondRes = SolveWorking(false, false);
+        m_avoidSolution.clear();
+        m_nogoods->Remove(differIdx);
+        if (m_options.learnNogoods) {
+            // what we learned since relies on excluding the first solution
+            m_nogoods->Clear();
+        }
+    }
+    m_limitGuessDepth = false;
+    
+    if (secondRes.completeSolve) {
+        VLOG(1) << "Found two solutions. Not unique";
+        crow::json::wvalue reasonJson;
+        reasonJson[0] = SerializeSolution(first);
+        reasonJson[1] = SerializeSolution(m_foundSolutions.front());
+        m_witnesses = {first.values, m_foundSolutions.front().values};
+        m_foundSolutions.clear();
+        res = {
+            false,
+            false,
+            {SolveSolution::ReasonType::NotUnique, std::move(reasonJson) }
+        };
+        LOG(INFO) << res;
+        return res;
+    }
+    if (secondRes.reason.reasonType == SolveSolution::ReasonType::GuessDepthExceeded
+        || secondRes.reason.reasonType == SolveSolution::ReasonType::BudgetExhausted
+    ) {
+        LOG(INFO) << secondRes;
+        return secondRes;
+    }
+    
+    LOG(INFO) << "Finished solving. Found solution.";
+    m_foundSolutions = {first};
+    res.reason.details["solutions"][0] = SerializeSolution(first);
+    res.reason.details["requiredGuessDepth"] = first.guesses.size();
+    return res;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolveLimitedDiscrepancy() {
+    LOG(INFO) << "Solving with limited discrepancies...";
+    StartBudget();
+    m_limitDiscrepancies = true;
+    unsigned long maxDiscrepancies = 0;
+    auto res = SolveSolution();
+    while (true) {
+        VLOG(1) << "Allowing " << maxDiscrepancies << " discrepancies";
+        ResetWorkingBranch();
+        m_discrepanciesLeft = maxDiscrepancies;
+        m_numDiscrepancyCutoffs = 0;
+        res = SolveWorking(false, false);
+        
+        // without any cutoffs, we searched the whole tree
+        if (res.completeSolve
+            || m_numDiscrepancyCutoffs == 0
+            || res.reason.reasonType == SolveSolution::ReasonType::BudgetExhausted
+        ) {
+            break;
+        }
+        ++maxDiscrepancies;
+    }
+    m_limitDiscrepancies = false;
+    
+    if (!res.valid) {
+        LOG(INFO) << res;
+    }
+    if (res.completeSolve) {
+        LOG(INFO) << "Finished solving. Found solution with " << maxDiscrepancies << " discrepancies.";
+        res.reason.details["solutions"][0] = SerializeSolution(m_foundSolutions.front());
+    }
+    res.reason.details["discrepancies"] = maxDiscrepancies;
+    return res;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolutionCount
+CspSolver<CSP, EnableIfPolicy<CSP>>::CountSolutions(unsigned long limit) {
+    LOG(INFO) << "Counting solutions...";
+    ResetWorkingBranch();
+    StartBudget();
+    const bool breakingSymmetries = BeginSymmetryBreaking();
+    m_countingSolutions = true;
+    m_solutionLimit = limit;
+    SolveWorking(false, false);
+    m_countingSolutions = false;
+    if (breakingSymmetries) {
+        EndSymmetryBreaking();
+    }
+    
+    SolutionCount out;
+    out.count = m_numSolutions;
+    out.budgetExhausted = m_budgetExhausted;
+    out.exact = !m_budgetExhausted && (limit == 0 || m_numSolutions < limit);
+    out.stats = m_stats;
+    LOG(INFO) << "Finished counting. " << (out.exact ? "" : "At least ") << out.count << " solutions.";
+    return out;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::DifficultyRating
+CspSolver<CSP, EnableIfPolicy<CSP>>::RateDifficulty(unsigned int stopAbove) {
+    SolveSolution result;
+    return RateDifficulty(result, stopAbove);
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::DifficultyRating
+CspSolver<CSP, EnableIfPolicy<CSP>>::RateDifficulty(SolveSolution& result, unsigned int stopAbove) {
+    LOG(INFO) << "Rating difficulty...";
+    StartBudget();
+    ResetWorkingBranch();
+    
+    DifficultyRating out {PropagationLevel::Bounds, false, 0, false};
+    result = RateWorking(out, stopAbove);
+    out.unique = result.valid && result.completeSolve;
+    if (result.completeSolve && out.guessDepth == 0) {
+        // solved without guessing, so SolveUnique did not report it
+        result.reason.details["solutions"][0] = SerializeSolution({m_working->CompactValues(), {}});
+        result.reason.details["requiredGuessDepth"] = 0;
+        result.reason.details["provingDepth"] = 0;
+    }
+    VLOG(1) << "Rated " << out.Score() << " (" << PropagationLevelName(out.propagation)
+        << (out.needsProbing ? ", probing" : "") << ", guess depth " << out.guessDepth << ")";
+    
+    // back to the propagation level of the options
+    ResetWorkingBranch();
+    return out;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::RateWorking(DifficultyRating& rating, unsigned int stopAbove) {
+    const SolveSolution tooHard {false, true, {SolveSolution::ReasonType::NotYetSolved, {} }};
+    for (auto level : kPropagationLevels) {
+        if (static_cast<unsigned int>(level) > stopAbove) {
+            return tooHard;
+        }
+        rating.propagation = level;
+        m_working->SetPropagationLevel(level);
+        auto res = PropagateWorking();
+        if (!res.valid || res.completeSolve) {
+            return res;
+        }
+    }
+    
+    rating.needsProbing = true;
+    if (rating.Score() > stopAbove) {
+        return tooHard;
+    }
+    auto res = ProbeWorking();
+    if (!res.valid || res.completeSolve) {
+        return res;
+    }
+    
+    // from the probed root, no deeper than the score allows
+    const unsigned int depthLeft = stopAbove - rating.Score();
+    if (depthLeft == 0) {
+        return tooHard;
+    }
+    const auto options = m_options;
+    if (m_options.maxGuessDepth == 0 || depthLeft < m_options.maxGuessDepth) {
+        // no branch needs more guesses than there are cells
+        m_options.maxGuessDepth = static_cast<unsigned int>(
+            std::min<std::size_t>(depthLeft, m_startingPoint->m_cells.size())
+        );
+    }
+    m_options.iterativeDeepening = true;
+    // still within the budget the rating started
+    res = SolveUniqueWorking();
+    m_options = options;
+    rating.guessDepth = m_guessDepthLimit;
+    return res;
+}
+
+template <typename CSP>
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolutionEnumerator::SolutionEnumerator(CspSolver& solver)
+    : m_solver(&solver)
+    , m_frames()
+    , m_started(false)
+    , m_stats()
+    , m_startTime(SolveBudget::Clock::now())
+    , m_budgetExhausted(false)
+{ }
+
+template <typename CSP>
+std::optional<typename CspSolver<CSP, EnableIfPolicy<CSP>>::CompactSolution>
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolutionEnumerator::Next() {
+    if (!m_started) {
+        m_started = true;
+        auto solution = Expand(std::make_unique<CSP>(*m_solver->m_startingPoint));
+        if (solution) {
+            return solution;
+        }
+    }
+    
+    while (!m_frames.empty()) {
+        auto& top = m_frames.back();
+        if (top.nextGuess == top.guesses.size()) {
+            m_frames.pop_back();
+            continue;
+        }
+        
+        auto child = std::make_unique<CSP>(*top.csp);
+        if (!child->ApplyGuess(top.guesses[top.nextGuess++])) {
+            continue;
+        }
+        auto solution = Expand(std::move(child));
+        if (solution) {
+            return solution;
+        }
+    }
+    return std::nullopt;
+}
+
+template <typename CSP>
+std::optional<typename CspSolver<CSP, EnableIfPolicy<CSP>>::CompactSolution>
+CspSolver<CSP, EnableIfPolicy<CSP>>::SolutionEnumerator::Expand(std::unique_ptr<CSP> csp) {
+    ++m_stats.nodes;
+    if (m_solver->m_options.budget.Exhausted(m_stats.nodes, m_startTime)) {
+        VLOG(1) << "Ran out of budget, stopping the enumeration";
+        m_budgetExhausted = true;
+        m_frames.clear();
+        return std::nullopt;
+    }
+    std::shared_ptr<Constraint> failedConstraint;
+    if (!m_solver->Propagate(*csp, failedConstraint)) {
+        ++m_stats.failures;
+        return std::nullopt;
+    }
+    if (csp->m_completelySolved) {
+        return csp->CompactValues();
+    }
+    
+    auto guesses = csp->GetGuesses(false, m_solver->m_options.branching);
+    m_frames.push_back({std::move(csp), std::move(guesses), 0});
+    return std::nullopt;
+}
+
+template <typename CSP>
+bool CspSolver<CSP, EnableIfPolicy<CSP>>::Refine(const std::function<bool(CSP&)>& change) {
+    assertm(m_workingBranch.size() == 1, "should only refine between solves");
+    if (!change(*m_startingPoint)) {
+        return false;
+    }
+    
+    m_foundSolutions.clear();
+    m_numSolutions = 0;
+    // explanations start from the propagated root, which gets redone
+    m_propagatedRoot.reset();
+    // a state can only have lost solutions, so the counts are too high now
+    m_transpositions->DropSolutionCounts();
+    // the supports may not survive the change
+    m_probeSupports.clear();
+    // the change can break symmetries
+    m_symmetries.reset();
+    m_inverseCellMaps.clear();
+    
+    if (!change(*m_working)) {
+        // only possible if the change leaves no solutions: the starting
+        // point will show it
+        VLOG(1) << "Refining the propagated root failed";
+        ResetWorkingBranch();
+    }
+    return true;
+}
+
+template <typename CSP>
+void CspSolver<CSP, EnableIfPolicy<CSP>>::StartBudget() {
+    m_stats = SearchStats();
+    m_budgetStart = SolveBudget::Clock::now();
+    m_budgetExhausted = false;
+}
+
+template <typename CSP>
+bool CspSolver<CSP, EnableIfPolicy<CSP>>::BudgetExhausted() {
+    if (!m_budgetExhausted && m_options.budget.Exhausted(m_stats.nodes, m_budgetStart)) {
+        VLOG(1) << "Ran out of budget after " << m_stats.nodes << " nodes";
+        m_budgetExhausted = true;
+    }
+    return m_budgetExhausted;
+}
+
+template <typename CSP>
+typename CspSolver<CSP, EnableIfPolicy<CSP>>::SolveSolution
+CspSolver<CSP, EnableIfPolicy<CSP>>::BudgetExhaustedSolution() const {
+    crow::json::wvalue reasonJson;
+    reasonJson["stats"] = m_stats.Serialize();
+    return {
+        false,
+        false,
+        {SolveSolution::ReasonType::BudgetExhausted, std::move(reasonJson) }
+    };
+}
+
+template <typename CSP>
+CSP CspSolver<CSP, EnableIfPolicy<CSP>>::SolutionCsp(const CompactSolution& values) const {
+    CSP out(*m_startingPoint);
+    bool valid = out.AssignCompactValues(values);
+    assertm(valid, "solution should be consistent with the starting point");
+    (void)valid;
+    return out;
+}
+
+template <typename CSP>
+crow::json::wvalue CspSolver<CSP, EnableIfPolicy<CSP>>::SerializeSolution(const FoundSolution& solution) const {
+    auto out = SolutionCsp(solution.values).Serialize();
+    out["requiredGuessDepth"] = solution.guesses.size();
+    return out;
+}
+
 template <typename CSP>
 void CspSolver<CSP, EnableIfPolicy<CSP>>::MakeGuess(const Guess& guess) {
     auto branch = m_workingBranch.top();
     branch.seq.push_back(guess);
-    branch.csp->m_cells.at(guess.cellKey)->SetVal(guess.val);
+    branch.csp->ApplyGuess(guess);
     m_workingBranch.push( std::move(branch) );
     m_working = m_workingBranch.top().csp.get();
 }
 
+template <typename CSP>
+void CspSolver<CSP, EnableIfPolicy<CSP>>::PopGuess() {
+    m_workingBranch.pop();
+    m_working = m_workingBranch.top().csp.get();
+}
+
+template <typename CSP>
+void CspSolver<CSP, EnableIfPolicy<CSP>>::ResetWorkingBranch() {
+    while (!m_workingBranch.empty()) {
+        m_workingBranch.pop();
+    }
+    m_foundSolutions.clear();
+    m_numSolutions = 0;
+    
+    SolveAttempt initialWorking;
+    initialWorking.csp = std::make_unique<CSP>(*m_startingPoint);
+    
+    m_workingBranch.push(std::move(initialWorking));
+    m_working = m_workingBranch.top().csp.get();
+}
+
 template class CspSolver<ConstraintSatisfactionProblem>;
 template class CspSolver<LatinSquare>;
 template class CspSolver<Futoshiki>;
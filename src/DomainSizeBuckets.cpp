@@ -0,0 +1,111 @@
+//
+//  DomainSizeBuckets.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/DomainSizeBuckets.hpp>
+
+#include <futoshiki/utils/Utils.hpp>
+
+namespace Csp {
+
+void DomainSizeBuckets::Insert(unsigned long key, std::size_t domainSize) {
+    if (key >= m_bucketOf.size()) {
+        m_bucketOf.resize(key + 1, kNotTracked);
+        m_positionIn.resize(key + 1, kNotTracked);
+    }
+
+    if (Contains(key)) {
+        Update(key, domainSize);
+        return;
+    }
+
+    if (domainSize < 2) {
+        return;
+    }
+
+    AddToBucket(key, domainSize);
+    ++m_numTracked;
+}
+
+void DomainSizeBuckets::Update(unsigned long key, std::size_t domainSize) {
+    if (!Contains(key)) {
+        return;
+    }
+
+    if (domainSize < 2) {
+        Remove(key);
+        return;
+    }
+
+    if (m_bucketOf[key] == domainSize) {
+        return;
+    }
+
+    RemoveFromBucket(key);
+    AddToBucket(key, domainSize);
+    AdvanceMinBucket();
+}
+
+void DomainSizeBuckets::Remove(unsigned long key) {
+    if (!Contains(key)) {
+        return;
+    }
+
+    RemoveFromBucket(key);
+    --m_numTracked;
+    AdvanceMinBucket();
+}
+
+bool DomainSizeBuckets::Contains(unsigned long key) const {
+    return key < m_bucketOf.size() && m_bucketOf[key] != kNotTracked;
+}
+
+unsigned long DomainSizeBuckets::SmallestDomainKey() const {
+    assertm(!Empty(), "no unsolved cells left to choose from");
+    assertm(!m_buckets[m_minBucket].empty(), "min bucket should be kept up to date");
+    return m_buckets[m_minBucket].front();
+}
+
+void DomainSizeBuckets::RemoveFromBucket(unsigned long key) {
+    auto& bucket = m_buckets[m_bucketOf[key]];
+    auto pos = m_positionIn[key];
+
+    // swap with the last key of the bucket, so we can pop in O(1)
+    auto lastKey = bucket.back();
+    bucket[pos] = lastKey;
+    m_positionIn[lastKey] = pos;
+    bucket.pop_back();
+
+    m_bucketOf[key] = kNotTracked;
+    m_positionIn[key] = kNotTracked;
+}
+
+void DomainSizeBuckets::AddToBucket(unsigned long key, std::size_t domainSize) {
+    if (domainSize >= m_buckets.size()) {
+        m_buckets.resize(domainSize + 1);
+    }
+
+    m_bucketOf[key] = domainSize;
+    m_positionIn[key] = m_buckets[domainSize].size();
+    m_buckets[domainSize].push_back(key);
+
+    // only ever lower the min bucket here, emptied buckets are skipped in AdvanceMinBucket
+    if (m_numTracked == 0 || domainSize < m_minBucket) {
+        m_minBucket = domainSize;
+    }
+}
+
+void DomainSizeBuckets::AdvanceMinBucket() {
+    if (m_numTracked == 0) {
+        m_minBucket = 0;
+        return;
+    }
+    while (m_buckets[m_minBucket].empty()) {
+        ++m_minBucket;
+    }
+}
+
+} // ::Csp
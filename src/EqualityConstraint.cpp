@@ -78,7 +78,7 @@ bool EqualityConstraint::EvalOnlyOptions() {
 }
 
 // bool: if the not equal condition turned out to be valid
-bool EqualityConstraint::EvalMutuallyExclusiveNotEqualConditions() {
+bool EqualityConstraint::EvalMutuallyExclusiveNotEqualConditions(std::size_t maxGroupSize) {
     // if we eliminate some variables, then we need to repeat
     // e.g. consider:
     //   four cells with (1, 2), (1, 2), (1, 2, 3), (1, 2, 3)
@@ -92,6 +92,9 @@ bool EqualityConstraint::EvalMutuallyExclusiveNotEqualConditions() {
              it_UniqueCombi != m_availableValues.end();
              it_UniqueCombi = m_availableValues.upper_bound(*it_UniqueCombi)
         ) {
+            if ((*it_UniqueCombi)->size() > maxGroupSize) {
+                continue;
+            }
             // the number of cells with the same possible value combinations
             // TODO: this doesn't work for some reason on some architectures / compilers ???
             // auto num = m_availableValues.count(*it_UniqueCombi);
@@ -222,12 +225,20 @@ bool EqualityConstraint::Apply() {
     assertm(IsActive(), "should not be applying inactive constraint");
     assertm(!m_provenInvalid, "Should not try to apply constraints that are already proven invalid");
     
+    m_changedWhileApplying = false;
     bool constraintWasValid = true;
     switch (m_operator) {
         case Operator::NotEqualTo: {
-            constraintWasValid = EvalMutuallyExclusiveNotEqualConditions();
+            const auto level = m_csp->GetPropagationLevel();
+            if (level >= PropagationLevel::NakedSingles) {
+                constraintWasValid = EvalMutuallyExclusiveNotEqualConditions(
+                    level >= PropagationLevel::HallSets ? m_cells.size() : 1
+                );
+            }
             // TODO: only do this if the prerequisite conditions are met
-            constraintWasValid = constraintWasValid && EvalOnlyOptions();
+            if (level >= PropagationLevel::HiddenSingles) {
+                constraintWasValid = constraintWasValid && EvalOnlyOptions();
+            }
             break;
         }
         case Operator::EqualTo: {
@@ -244,6 +255,12 @@ bool EqualityConstraint::Apply() {
         VLOG(2) << "Could not apply constraint, it was not valid";
     }
     
+    // what we deduced may let us deduce more (e.g. a hidden single makes a
+    // naked pair elsewhere in the row), so stay active until nothing changes
+    if (constraintWasValid && !m_solved && m_changedWhileApplying) {
+        return true;
+    }
+    
     m_relatedCellsChanged = false;
     
     if(!m_solved) { // transition to inactive not yet reported when the cell reported back to the constraint
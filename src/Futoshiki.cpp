@@ -6,10 +6,23 @@
 //
 
 #include <futoshiki/Futoshiki.hpp>
+#include <futoshiki/InequalityConstraint.hpp>
+#include <futoshiki/LatinSquareSampler.hpp>
+#include <futoshiki/LocalSearch.hpp>
 #include <futoshiki/utils/Utils.hpp>
+#include <futoshiki/utils/ThreadPool.hpp>
 #include <futoshiki/utils/easylogging++.h>
 
 #include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <bitset>
+#include <future>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
 
 namespace Csp {
 
@@ -32,105 +45,942 @@ GenAdjacentCellPairs(const unsigned long numRows, const unsigned long numCols) {
     
     return out;
 }
-    
-}
 
-bool Futoshiki::AddRandomConstraint(
-    const Futoshiki& refSolution
+// givens or inequalities at even odds, unless there are none of one type
+const std::vector<Futoshiki::PuzzleConstraint>& ChooseConstraintType(
+    const std::vector<Futoshiki::PuzzleConstraint>& givens,
+    const std::vector<Futoshiki::PuzzleConstraint>& inequalities
 ) {
-    
     std::vector<double> weights{50,50};
     std::discrete_distribution<int> dist(std::begin(weights), std::end(weights));
     std::mt19937 gen{std::random_device{}()};
     
-    if (dist(gen)) {
-        bool interestingConstraint = true;
-        do {
-            auto remainingCells = RemainingCellKeys();
-            auto unsolvedCell = Utils::SelectRandomly(remainingCells.begin(), remainingCells.end());
-            
-            bool redundantConstraint =
-                m_cells.at(*unsolvedCell)->Value() == *m_defaultPossibleValues.begin() &&
-                m_cells.at(*unsolvedCell)->HasAppliedConstraint(static_cast<int>(Constraint::Operator::LessThan) );
-            redundantConstraint = redundantConstraint ||
-                ( m_cells.at(*unsolvedCell)->Value() == *m_defaultPossibleValues.rbegin() &&
-                m_cells.at(*unsolvedCell)->HasAppliedConstraint(static_cast<int>(Constraint::Operator::GreaterThan) ) );
-            
-            if (!redundantConstraint) {
-                m_cells.at(*unsolvedCell)->SetVal(
-                    refSolution.m_cells.at(*unsolvedCell)->Value());
-                interestingConstraint = true;
-            }
-            
+    return (dist(gen) && !givens.empty()) || inequalities.empty()
+        ? givens
+        : inequalities;
+}
+
+// counting solutions beyond this tells candidates apart no better
+constexpr unsigned long kCandidateSolutionLimit = 16;
+// past this, a count only bounds the number of solutions from below
+constexpr unsigned long kCandidateCountNodes = 200;
+
+// lower is better
+struct CandidateScore {
+    unsigned long numSolutions;
+    unsigned long numPossibleValues;
+    
+    friend bool operator<(const CandidateScore& lhs, const CandidateScore& rhs) {
+        return std::tie(lhs.numSolutions, lhs.numPossibleValues) < std::tie(rhs.numSolutions, rhs.numPossibleValues);
+    }
+};
+
+CandidateScore ScoreCandidate(
+    const Futoshiki& root,
+    const Futoshiki::PuzzleConstraint& candidate,
+    CandidateScoring scoring,
+    const SolveBudget& budget
+) {
+    Futoshiki refined(root);
+    bool valid = refined.ApplyConstraint(candidate);
+    assertm(valid, "candidates hold for the reference solution, so cannot make the puzzle invalid");
+    (void)valid;
+    SolverOptions scoreOptions;
+    scoreOptions.budget = budget;
+    if (scoreOptions.budget.maxNodes == 0 || scoreOptions.budget.maxNodes > kCandidateCountNodes) {
+        scoreOptions.budget.maxNodes = kCandidateCountNodes;
+    }
+    auto solver = CspSolver<Futoshiki>(std::move(refined), scoreOptions);
+    
+    CandidateScore out {0, 0};
+    if (scoring == CandidateScoring::SolutionCount) {
+        out.numSolutions = solver.CountSolutions(kCandidateSolutionLimit).count;
+    }
+    solver.SolveDeterministic();
+    for (auto domain : solver.Root().GetDomainMasks()) {
+        out.numPossibleValues += std::bitset<64>(domain).count();
+    }
+    return out;
+}
+
+// the budget for the next solve, with what is left of the time limit
+SolveBudget RemainingBudget(const GeneratorOptions& options, SolveBudget::Clock::time_point startTime) {
+    auto budget = options.budget;
+    if (budget.maxTime.count() > 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(SolveBudget::Clock::now() - startTime);
+        if (elapsed >= budget.maxTime) {
+            throw BudgetExhaustedError("ran out of time generating the puzzle");
         }
-        while(!interestingConstraint);
+        budget.maxTime -= elapsed;
     }
-    else {
-        bool interestingConstraint = false;
-        do {
-            auto possibleCellPairs = GenAdjacentCellPairs(m_numCols, m_numRows);
-            auto cellCoords = Utils::SelectRandomly(possibleCellPairs.begin(), possibleCellPairs.end());
-            auto lhsCellIdx = CoordsToIndex(cellCoords->first);
-            auto rhsCellIdx = CoordsToIndex(cellCoords->second);
-
-            auto op = refSolution.m_cells.at(lhsCellIdx)->Value() < refSolution.m_cells.at(rhsCellIdx)->Value()
-                ? Constraint::Operator::LessThan
-                : Constraint::Operator::GreaterThan;
-            
-            bool bothCellsAlreadySolved =
-                m_cells.at(lhsCellIdx)->IsSolved() &&
-                m_cells.at(rhsCellIdx)->IsSolved();
-            
-            bool redundantConstraint =
-                m_cells.at(lhsCellIdx)->Value() == *m_defaultPossibleValues.begin() ||
-                m_cells.at(lhsCellIdx)->Value() == *m_defaultPossibleValues.rbegin() ||
-                m_cells.at(rhsCellIdx)->Value() == *m_defaultPossibleValues.begin() ||
-                m_cells.at(rhsCellIdx)->Value() == *m_defaultPossibleValues.rbegin();
-            
-            interestingConstraint = !bothCellsAlreadySolved && !redundantConstraint;
-            
-            if (interestingConstraint) {
-                AddInequalityConstraint(cellCoords->first, op, cellCoords->second);
+    if (budget.deadline && SolveBudget::Clock::now() >= *budget.deadline) {
+        throw BudgetExhaustedError("ran out of time generating the puzzle");
+    }
+    return budget;
+}
+
+// DifficultyRating::Score of the puzzles needing probing, guesses come on top
+constexpr unsigned int kProbingScore = 4;
+
+// whether propagation narrowed the puzzle down enough for a uniqueness
+// check to have a chance
+bool WorthChecking(const Futoshiki& propagated, const GeneratorOptions& options) {
+    if (options.quickFilterSpace >= 1) {
+        return true;
+    }
+    const auto size = static_cast<double>(propagated.Size());
+    const auto emptyBoardSpace = size * size * std::log2(size);
+    return propagated.Log2SearchSpace() <= options.quickFilterSpace * emptyBoardSpace;
+}
+
+// a fresh puzzle with just these clues
+Futoshiki BuildPuzzle(unsigned long size, const std::vector<Futoshiki::PuzzleConstraint>& clues) {
+    Futoshiki out(size);
+    for (const auto& clue : clues) {
+        out.ApplyConstraint(clue);
+    }
+    return out;
+}
+
+// the kept clues, apart from the ones taken out (by index)
+std::vector<Futoshiki::PuzzleConstraint> KeptClues(
+    const std::vector<Futoshiki::PuzzleConstraint>& clues,
+    const std::vector<bool>& kept,
+    const std::vector<std::size_t>& takenOut
+) {
+    std::vector<Futoshiki::PuzzleConstraint> out;
+    for (std::size_t idx = 0; idx < clues.size(); ++idx) {
+        if (kept[idx] && std::find(takenOut.begin(), takenOut.end(), idx) == takenOut.end()) {
+            out.push_back(clues[idx]);
+        }
+    }
+    return out;
+}
+
+bool ProvenUnique(
+    unsigned long size,
+    const std::vector<Futoshiki::PuzzleConstraint>& clues,
+    unsigned int maxGuessDepth,
+    const SolveBudget& budget
+) {
+    SolverOptions checkOptions;
+    checkOptions.budget = budget;
+    checkOptions.maxGuessDepth = maxGuessDepth;
+    auto solver = CspSolver<Futoshiki>(BuildPuzzle(size, clues), checkOptions);
+    auto res = solver.SolveUnique();
+    if (res.reason.reasonType == CspSolver<Futoshiki>::SolveSolution::ReasonType::BudgetExhausted) {
+        throw BudgetExhaustedError("ran out of budget checking the puzzle is unique");
+    }
+    return res.completeSolve;
+}
+
+// the DifficultyRating::Score of the puzzle with just these clues, if it is
+// unique and rates no harder than the difficulty of the options
+std::optional<unsigned int> ScoreAtMost(
+    unsigned long size,
+    const std::vector<Futoshiki::PuzzleConstraint>& clues,
+    const GeneratorOptions& options,
+    const SolveBudget& budget
+) {
+    SolverOptions ratingOptions;
+    ratingOptions.budget = budget;
+    ratingOptions.maxGuessDepth = options.maxGuessDepth;
+    auto rating = CspSolver<Futoshiki>(BuildPuzzle(size, clues), ratingOptions).RateDifficulty(*options.difficulty);
+    if (!rating.unique) {
+        return std::nullopt;
+    }
+    return rating.Score();
+}
+
+// the possible values of a cell, as their counterparts under the transform
+std::uint64_t TransformMask(std::uint64_t mask, const BoardTransform& transform, unsigned long size) {
+    std::uint64_t out = 0;
+    for (int val = 1; val <= static_cast<int>(size); ++val) {
+        if (mask & (std::uint64_t(1) << val)) {
+            out |= std::uint64_t(1) << transform.ApplyToValue(val, size);
+        }
+    }
+    return out;
+}
+
+// splitmix64 over the words of the key, seeded by the size of the board
+std::uint64_t HashKey(unsigned long size, const std::vector<std::uint64_t>& key) {
+    auto mix = [](std::uint64_t z) {
+        z += 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    };
+    std::uint64_t hash = mix(size);
+    for (auto word : key) {
+        hash = mix(hash ^ word);
+    }
+    return hash;
+}
+
+// the same possible values everywhere, and the same inequalities
+bool SameClues(const Futoshiki& lhs, const Futoshiki& rhs) {
+    if (lhs.GetDomainMasks() != rhs.GetDomainMasks()) {
+        return false;
+    }
+    auto lhsInequalities = lhs.Inequalities();
+    auto rhsInequalities = rhs.Inequalities();
+    std::sort(lhsInequalities.begin(), lhsInequalities.end());
+    std::sort(rhsInequalities.begin(), rhsInequalities.end());
+    return std::equal(
+        lhsInequalities.begin(), lhsInequalities.end(),
+        rhsInequalities.begin(), rhsInequalities.end(),
+        [](const auto& lhsInequality, const auto& rhsInequality) {
+            return lhsInequality.lessKey == rhsInequality.lessKey
+                && lhsInequality.greaterKey == rhsInequality.greaterKey;
+        }
+    );
+}
+    
+}
+
+bool Futoshiki::PuzzleConstraint::HoldsFor(const std::vector<std::uint8_t>& values) const {
+    switch (type) {
+        case Type::Given:
+            return values.at(lhsKey) == val;
+        case Type::Inequality:
+            return op == Constraint::Operator::LessThan
+                ? values.at(lhsKey) < values.at(rhsKey)
+                : values.at(lhsKey) > values.at(rhsKey);
+    }
+    return false;
+}
+
+void Futoshiki::CandidateConstraints(
+    const std::vector<std::uint8_t>& refSolution,
+    std::vector<PuzzleConstraint>& givens,
+    std::vector<PuzzleConstraint>& inequalities
+) const {
+    // givens on the cells which are not solved yet
+    for (auto cellKey : RemainingCellKeys()) {
+        givens.push_back({
+            PuzzleConstraint::Type::Given,
+            cellKey,
+            Constraint::Operator::EqualTo,
+            cellKey,
+            refSolution.at(cellKey)
+        });
+    }
+    
+    // inequalities between adjacent cells, unless both are solved or one of
+    // them holds the lowest or highest value (it is already clear which way
+    // round the inequality goes), or the puzzle has it already
+    auto existing = Inequalities();
+    std::sort(existing.begin(), existing.end());
+    for (const auto& cellCoords : GenAdjacentCellPairs(m_numCols, m_numRows)) {
+        auto lhsCellIdx = CoordsToIndex(cellCoords.first);
+        auto rhsCellIdx = CoordsToIndex(cellCoords.second);
+        
+        bool bothCellsAlreadySolved =
+            m_cells.at(lhsCellIdx)->IsSolved() &&
+            m_cells.at(rhsCellIdx)->IsSolved();
+        
+        bool redundantConstraint =
+            m_cells.at(lhsCellIdx)->Value() == *m_defaultPossibleValues.begin() ||
+            m_cells.at(lhsCellIdx)->Value() == *m_defaultPossibleValues.rbegin() ||
+            m_cells.at(rhsCellIdx)->Value() == *m_defaultPossibleValues.begin() ||
+            m_cells.at(rhsCellIdx)->Value() == *m_defaultPossibleValues.rbegin();
+        
+        auto op = refSolution.at(lhsCellIdx) < refSolution.at(rhsCellIdx)
+            ? Constraint::Operator::LessThan
+            : Constraint::Operator::GreaterThan;
+        auto inequality = op == Constraint::Operator::LessThan
+            ? Inequality{lhsCellIdx, rhsCellIdx}
+            : Inequality{rhsCellIdx, lhsCellIdx};
+        bool alreadyThere = std::binary_search(existing.begin(), existing.end(), inequality);
+        
+        if (bothCellsAlreadySolved || redundantConstraint || alreadyThere) {
+            continue;
+        }
+        
+        inequalities.push_back({
+            PuzzleConstraint::Type::Inequality,
+            lhsCellIdx,
+            op,
+            rhsCellIdx,
+            0
+        });
+    }
+}
+
+std::optional<Futoshiki::PuzzleConstraint> Futoshiki::ChooseRandomConstraint(
+    const std::vector<std::uint8_t>& refSolution
+) const {
+    std::vector<PuzzleConstraint> givens;
+    std::vector<PuzzleConstraint> inequalities;
+    CandidateConstraints(refSolution, givens, inequalities);
+    
+    const auto& chosen = ChooseConstraintType(givens, inequalities);
+    if (chosen.empty()) {
+        return std::nullopt;
+    }
+    return *Utils::SelectRandomly(chosen.begin(), chosen.end());
+}
+
+std::optional<Futoshiki::PuzzleConstraint> Futoshiki::ChooseConstraintAgainst(
+    const std::vector<std::uint8_t>& refSolution,
+    const std::vector< std::vector<std::uint8_t> >& witnesses
+) const {
+    std::vector<PuzzleConstraint> givens;
+    std::vector<PuzzleConstraint> inequalities;
+    CandidateConstraints(refSolution, givens, inequalities);
+    
+    // keeps the candidates ruling out the most witnesses
+    auto keepBest = [&witnesses](std::vector<PuzzleConstraint>& candidates) {
+        std::vector<PuzzleConstraint> best;
+        std::size_t mostRuledOut = 1;
+        for (const auto& candidate : candidates) {
+            auto numRuledOut = static_cast<std::size_t>(std::count_if(
+                witnesses.begin(),
+                witnesses.end(),
+                [&candidate](const std::vector<std::uint8_t>& witness) { return !candidate.HoldsFor(witness); }
+            ));
+            if (numRuledOut > mostRuledOut) {
+                best.clear();
+                mostRuledOut = numRuledOut;
+            }
+            if (numRuledOut == mostRuledOut) {
+                best.push_back(candidate);
             }
         }
-        while(!interestingConstraint);
+        candidates = std::move(best);
+    };
+    keepBest(givens);
+    keepBest(inequalities);
+    
+    const auto& chosen = ChooseConstraintType(givens, inequalities);
+    if (chosen.empty()) {
+        return std::nullopt;
     }
-    return true;
+    return *Utils::SelectRandomly(chosen.begin(), chosen.end());
+}
+
+bool Futoshiki::ApplyConstraint(const PuzzleConstraint& constraint) {
+    switch (constraint.type) {
+        case PuzzleConstraint::Type::Given:
+            return ApplyGuess({constraint.lhsKey, constraint.val});
+        case PuzzleConstraint::Type::Inequality:
+            return ConstraintSatisfactionProblem::AddInequalityConstraint(
+                constraint.lhsKey,
+                constraint.op,
+                constraint.rhsKey
+            );
+    }
+    return false;
+}
+
+bool Futoshiki::AddRandomConstraint(
+    const std::vector<std::uint8_t>& refSolution
+) {
+    auto constraint = ChooseRandomConstraint(refSolution);
+    return constraint && ApplyConstraint(*constraint);
 }
 
-Futoshiki Futoshiki::Generate(unsigned long size) {
+Futoshiki Futoshiki::Generate(unsigned long size, const GeneratorOptions& options) {
     LOG(INFO) << "Generating Futoshiki puzzle";
+    if (options.difficulty && *options.difficulty > kMaxGeneratedDifficulty) {
+        throw std::invalid_argument("puzzles needing guesses are not generated");
+    }
+    const auto startTime = SolveBudget::Clock::now();
     
+    auto attemptOptions = options;
+    for (unsigned int attempt = 1; ; ++attempt) {
+        auto out = GenerateAttempt(size, attemptOptions, startTime);
+        if (out) {
+            return std::move(*out);
+        }
+        if (options.maxAttempts > 0 && attempt >= options.maxAttempts) {
+            throw BudgetExhaustedError("no puzzle of the difficulty within the attempts");
+        }
+        LOG(INFO) << "Missed the difficulty, starting over";
+        // a fixed seed would sample the same reference again
+        if (attemptOptions.seed) {
+            ++*attemptOptions.seed;
+        }
+    }
+}
+
+std::optional<Futoshiki> Futoshiki::GenerateAttempt(
+    unsigned long size,
+    const GeneratorOptions& options,
+    SolveBudget::Clock::time_point startTime
+) {
     Futoshiki out(size);
     
     LOG(INFO) << "Generating reference";
-    auto solver = Csp::CspSolver<Futoshiki>(Futoshiki(out));
-    auto res = solver.SolveRandom();
-    assertm(res.completeSolve, "empty board should be randomly solveable");
-    auto reference = solver.GetSolutions().front();
+    // any latin square is a solution of the empty board, so sample one
+    // uniformly instead of solving for it
+    auto reference = LatinSquareSampler(size, options.mixingSteps, options.seed).Sample();
+    
+    if (options.strategy == GenerationStrategy::Subtractive || options.difficulty) {
+        return GenerateSubtractively(size, reference, options, startTime);
+    }
     
     LOG(INFO) << "Adding constraints until uniquely solveable";
     
     // have not proven that we need at least (size - 1) [note we add one at the
     // beginning of the do loop below] constraints for a futoshiki puzzle, but
     // I think we do
-    for (int i = 0; i < size - 2; ++i) {
+    for (unsigned long i = 0; i + 2 < size; ++i) {
         LOG(INFO) << "Adding Constraint...";
-        out.AddRandomConstraint(*reference.csp);
+        out.AddRandomConstraint(reference);
+    }
+    
+    if (options.incremental) {
+        return GenerateIncrementally(std::move(out), reference, options, startTime);
     }
     
     bool nowSolveable = false;
     do {
         LOG(INFO) << "Adding Constraint...";
-        out.AddRandomConstraint(*reference.csp);
+        out.AddRandomConstraint(reference);
         
         Futoshiki copy(out);
-        auto solver = Csp::CspSolver<Futoshiki>(std::move(copy));
-        res = solver.SolveUnique();
+        SolverOptions checkOptions;
+        checkOptions.budget = RemainingBudget(options, startTime);
+        checkOptions.maxGuessDepth = options.maxGuessDepth;
+        auto solver = Csp::CspSolver<Futoshiki>(std::move(copy), checkOptions);
+        solver.SolveDeterministic();
+        if (!WorthChecking(solver.Root(), options)) {
+            VLOG(1) << "Too much left after propagation, not checking";
+            continue;
+        }
+        auto res = solver.SolveUnique();
+        if (res.reason.reasonType == CspSolver<Futoshiki>::SolveSolution::ReasonType::BudgetExhausted) {
+            throw BudgetExhaustedError("ran out of budget checking the puzzle is unique");
+        }
+        nowSolveable = res.completeSolve;
+    }
+    while (!nowSolveable);
+    return out;
+}
+
+std::optional<Futoshiki::PuzzleConstraint> Futoshiki::ChooseBestCandidate(
+    const Futoshiki& root,
+    const std::vector<std::uint8_t>& reference,
+    const GeneratorOptions& options,
+    Utils::ThreadPool& pool,
+    const SolveBudget& budget
+) {
+    std::vector<PuzzleConstraint> givens;
+    std::vector<PuzzleConstraint> inequalities;
+    root.CandidateConstraints(reference, givens, inequalities);
+    // all of the same type, or the stronger givens would always win
+    auto candidates = ChooseConstraintType(givens, inequalities);
+    std::shuffle(candidates.begin(), candidates.end(), std::mt19937{std::random_device{}()});
+    if (candidates.size() > options.candidates) {
+        candidates.resize(options.candidates);
+    }
+    
+    std::vector< std::future<CandidateScore> > scores;
+    for (const auto& candidate : candidates) {
+        // the root stays as is until every score is in
+        scores.push_back(pool.Submit([&root, candidate, &options, budget]() {
+            return ScoreCandidate(root, candidate, options.candidateScoring, budget);
+        }));
+    }
+    
+    // (no task may be left reading the root, even if one of them threw)
+    for (const auto& score : scores) {
+        score.wait();
+    }
+    std::optional<PuzzleConstraint> out;
+    std::optional<CandidateScore> bestScore;
+    for (std::size_t idx = 0; idx < candidates.size(); ++idx) {
+        auto score = scores[idx].get();
+        if (!bestScore || score < *bestScore) {
+            bestScore = score;
+            out = candidates[idx];
+        }
+    }
+    if (bestScore) {
+        VLOG(1) << "Best of " << candidates.size() << " candidates leaves "
+            << bestScore->numPossibleValues << " possible values";
+    }
+    return out;
+}
+
+Futoshiki Futoshiki::GenerateIncrementally(
+    Futoshiki&& out,
+    const std::vector<std::uint8_t>& reference,
+    const GeneratorOptions& options,
+    SolveBudget::Clock::time_point startTime
+) {
+    // one solver for all the checks: each constraint is added to the root it
+    // already propagated, and the nogoods it learned about the puzzle still
+    // hold once there are more constraints
+    SolverOptions checkOptions;
+    checkOptions.maxGuessDepth = options.maxGuessDepth;
+    checkOptions.learnNogoods = true;
+    auto solver = Csp::CspSolver<Futoshiki>(Futoshiki(out), checkOptions);
+    // solutions other than the reference, found by the checks
+    std::vector< std::vector<std::uint8_t> > witnesses;
+    std::optional<Utils::ThreadPool> pool;
+    if (options.candidates > 1) {
+        pool.emplace(options.threads);
+    }
+    
+    bool nowSolveable = false;
+    do {
+        LOG(INFO) << "Adding Constraint...";
+        // chosen on the propagated root, so no constraint goes to cells that
+        // the earlier ones already settle
+        std::optional<PuzzleConstraint> constraint;
+        if (!witnesses.empty()) {
+            constraint = solver.Root().ChooseConstraintAgainst(reference, witnesses);
+        }
+        if (!constraint && pool) {
+            constraint = ChooseBestCandidate(solver.Root(), reference, options, *pool, RemainingBudget(options, startTime));
+        }
+        if (!constraint) {
+            constraint = solver.Root().ChooseRandomConstraint(reference);
+        }
+        assertm(constraint.has_value(), "puzzle not proven unique yet should have unsolved cells");
+        out.ApplyConstraint(*constraint);
+        bool valid = solver.Refine([&constraint](Futoshiki& csp) { return csp.ApplyConstraint(*constraint); });
+        assertm(valid, "constraints hold for the reference solution, so cannot make the puzzle invalid");
+        (void)valid;
+        
+        witnesses.erase(
+            std::remove_if(
+                witnesses.begin(),
+                witnesses.end(),
+                [&constraint](const std::vector<std::uint8_t>& witness) { return !constraint->HoldsFor(witness); }
+            ),
+            witnesses.end()
+        );
+        if (!witnesses.empty()) {
+            // they are still solutions, so there is no point checking yet
+            VLOG(1) << witnesses.size() << " other solutions left, not checking";
+            continue;
+        }
+        
+        // propagation is cheap next to the search
+        solver.SolveDeterministic();
+        if (!WorthChecking(solver.Root(), options)) {
+            VLOG(1) << "Too much left after propagation, not checking";
+            continue;
+        }
+        
+        solver.SetBudget(RemainingBudget(options, startTime));
+        auto res = solver.SolveUnique();
+        if (res.reason.reasonType == CspSolver<Futoshiki>::SolveSolution::ReasonType::BudgetExhausted) {
+            throw BudgetExhaustedError("ran out of budget checking the puzzle is unique");
+        }
         nowSolveable = res.completeSolve;
+        if (options.useWitnesses) {
+            for (const auto& witness : solver.GetWitnesses()) {
+                if (witness != reference) {
+                    witnesses.push_back(witness);
+                }
+            }
+        }
     }
     while (!nowSolveable);
+    return std::move(out);
+}
+
+std::optional<Futoshiki> Futoshiki::GenerateSubtractively(
+    unsigned long size,
+    const std::vector<std::uint8_t>& reference,
+    const GeneratorOptions& options,
+    SolveBudget::Clock::time_point startTime
+) {
+    // every given and every inequality of the reference: trivially unique
+    std::vector<PuzzleConstraint> clues;
+    std::vector<PuzzleConstraint> inequalities;
+    Futoshiki(size).CandidateConstraints(reference, clues, inequalities);
+    const auto numGivens = clues.size();
+    clues.insert(clues.end(), inequalities.begin(), inequalities.end());
+    
+    std::vector<std::size_t> pending(clues.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    std::mt19937 gen(options.seed ? *options.seed : std::random_device{}());
+    if (options.difficulty && *options.difficulty < kProbingScore) {
+        // givens first: leaving mostly inequalities makes for puzzles which
+        // need the stronger propagation levels (but are slow to probe)
+        std::shuffle(pending.begin(), pending.begin() + static_cast<long>(numGivens), gen);
+        std::shuffle(pending.begin() + static_cast<long>(numGivens), pending.end(), gen);
+    }
+    else {
+        std::shuffle(pending.begin(), pending.end(), gen);
+    }
+    std::vector<bool> kept(clues.size(), true);
+    
+    Utils::ThreadPool pool(options.threads);
+    const std::size_t batchSize = options.removalBatch > 0 ? options.removalBatch : pool.Size();
+    
+    // for each removal (of one or more clues) from the kept clues, whether
+    // the puzzle is still unique and no harder than the difficulty: then the
+    // score of its rating (0 without a difficulty)
+    using Check = std::optional<unsigned int>;
+    auto checkRemovals = [&](const std::vector< std::vector<std::size_t> >& removals) {
+        auto budget = RemainingBudget(options, startTime);
+        std::vector< std::future<Check> > checks;
+        for (const auto& removal : removals) {
+            checks.push_back(pool.Submit([size, remaining = KeptClues(clues, kept, removal), &options, budget]() -> Check {
+                if (options.difficulty) {
+                    return ScoreAtMost(size, remaining, options, budget);
+                }
+                if (ProvenUnique(size, remaining, options.maxGuessDepth, budget)) {
+                    return 0;
+                }
+                return std::nullopt;
+            }));
+        }
+        std::vector<Check> out;
+        for (auto& check : checks) {
+            out.push_back(check.get());
+        }
+        return out;
+    };
+    auto passes = [](const Check& check) { return check.has_value(); };
+    
+    // all the givens rate 0, which any difficulty above it has to climb
+    // from. Once the removals got there we stop, rather than removing the
+    // rest only to find out whether the puzzle stayed there.
+    const bool stopAtDifficulty = options.difficulty && *options.difficulty > 0;
+    bool reachedDifficulty = false;
+    
+    LOG(INFO) << "Removing " << clues.size() << " clues while uniquely solveable";
+    while (!pending.empty()) {
+        auto batchEnd = pending.begin() + static_cast<long>(std::min(batchSize, pending.size()));
+        std::vector<std::size_t> batch(pending.begin(), batchEnd);
+        pending.erase(pending.begin(), batchEnd);
+        
+        // the whole batch speculatively, alongside each clue on its own
+        std::vector< std::vector<std::size_t> > removals;
+        if (batch.size() > 1) {
+            removals.push_back(batch);
+        }
+        for (auto idx : batch) {
+            removals.push_back({idx});
+        }
+        auto unique = checkRemovals(removals);
+        if (batch.size() > 1 && unique.front()) {
+            VLOG(1) << "Removed a batch of " << batch.size() << " clues";
+            for (auto idx : batch) {
+                kept[idx] = false;
+            }
+            if (stopAtDifficulty && *unique.front() == *options.difficulty) {
+                reachedDifficulty = true;
+                break;
+            }
+            continue;
+        }
+        
+        // roll back to removing the first clue which can go on its own. The
+        // ones before it are needed with more clues around, so also once
+        // there are fewer. The others which could go on their own might not
+        // once it is gone, so they get checked again.
+        auto single = unique.begin() + (batch.size() > 1 ? 1 : 0);
+        auto first = std::find_if(single, unique.end(), passes);
+        if (first == unique.end()) {
+            continue;
+        }
+        kept[batch[first - single]] = false;
+        if (stopAtDifficulty && **first == *options.difficulty) {
+            reachedDifficulty = true;
+            break;
+        }
+        std::vector<std::size_t> recheck;
+        for (auto it = first + 1; it != unique.end(); ++it) {
+            if (passes(*it)) {
+                recheck.push_back(batch[it - single]);
+            }
+        }
+        pending.insert(pending.begin(), recheck.begin(), recheck.end());
+    }
+    if (stopAtDifficulty && !reachedDifficulty) {
+        VLOG(1) << "No clue can go, and the puzzle rates below difficulty " << *options.difficulty;
+        return std::nullopt;
+    }
+    
+    // the checks only prove uniqueness within the guess depth, which is not
+    // quite monotone in the clues: make sure none of the kept ones can go
+    // (unless we stopped at the difficulty on purpose)
+    if (!reachedDifficulty) {
+        LOG(INFO) << "Checking no clue is redundant";
+        bool removedAny = false;
+        do {
+            std::vector<std::size_t> keptIdxs;
+            std::vector< std::vector<std::size_t> > removals;
+            for (std::size_t idx = 0; idx < clues.size(); ++idx) {
+                if (kept[idx]) {
+                    keptIdxs.push_back(idx);
+                    removals.push_back({idx});
+                }
+            }
+            auto unique = checkRemovals(removals);
+            auto first = std::find_if(unique.begin(), unique.end(), passes);
+            removedAny = first != unique.end();
+            if (removedAny) {
+                VLOG(1) << "Removed a redundant clue";
+                kept[keptIdxs[first - unique.begin()]] = false;
+            }
+        }
+        while (removedAny);
+    }
+    
+    auto out = KeptClues(clues, kept, {});
+    LOG(INFO) << "Kept " << out.size() << " of " << clues.size() << " clues";
+    return BuildPuzzle(size, out);
+}
+
+std::vector<Futoshiki::Inequality> Futoshiki::Inequalities() const {
+    std::vector<Inequality> out;
+    for (const auto& constraint : m_constraints) {
+        auto inequality = dynamic_cast<const InequalityConstraint*>(constraint.get());
+        if (!inequality) {
+            continue;
+        }
+        if (inequality->GetOperator() == Constraint::Operator::LessThan) {
+            out.push_back({inequality->LhsKey(), inequality->RhsKey()});
+        }
+        else {
+            out.push_back({inequality->RhsKey(), inequality->LhsKey()});
+        }
+    }
+    return out;
+}
+
+bool Futoshiki::IsSymmetricUnder(const BoardTransform& transform) const {
+    auto domains = GetDomainMasks();
+    if (domains.empty()) {
+        return false;
+    }
+    for (unsigned long key = 0; key < domains.size(); ++key) {
+        if (domains[transform.ApplyToKey(key, m_size)] != TransformMask(domains[key], transform, m_size)) {
+            return false;
+        }
+    }
+    
+    auto inequalities = Inequalities();
+    std::sort(inequalities.begin(), inequalities.end());
+    for (const auto& inequality : inequalities) {
+        auto lessKey = transform.ApplyToKey(inequality.lessKey, m_size);
+        auto greaterKey = transform.ApplyToKey(inequality.greaterKey, m_size);
+        if (transform.reverseValues) {
+            std::swap(lessKey, greaterKey);
+        }
+        if (!std::binary_search(inequalities.begin(), inequalities.end(), Inequality{lessKey, greaterKey})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CspSymmetry Futoshiki::ToSymmetry(const BoardTransform& transform) const {
+    CspSymmetry out;
+    for (unsigned long key = 0; key < m_size * m_size; ++key) {
+        out.cellMap.push_back(transform.ApplyToKey(key, m_size));
+    }
+    for (int val = 0; val <= static_cast<int>(m_size); ++val) {
+        out.valueMap.push_back(transform.ApplyToValue(val, m_size));
+    }
+    return out;
+}
+
+Futoshiki Futoshiki::Transformed(const BoardTransform& transform) const {
+    Futoshiki out(m_size);
+    out.SetPropagationLevel(GetPropagationLevel());
+    
+    // from the cells rather than GetDomainMasks, which is empty on boards
+    // with values of 64 and up
+    for (const auto& [key, cell] : m_cells) {
+        const auto& possibleValues = cell->GetPossibleValuesRef();
+        auto mappedKey = transform.ApplyToKey(key, m_size);
+        for (int val = 1; val <= static_cast<int>(m_size); ++val) {
+            if (possibleValues.count(val) == 0) {
+                out.RefuteGuess({mappedKey, transform.ApplyToValue(val, m_size)});
+            }
+        }
+    }
+    
+    for (const auto& inequality : Inequalities()) {
+        auto lessKey = transform.ApplyToKey(inequality.lessKey, m_size);
+        auto greaterKey = transform.ApplyToKey(inequality.greaterKey, m_size);
+        if (transform.reverseValues) {
+            std::swap(lessKey, greaterKey);
+        }
+        out.ConstraintSatisfactionProblem::AddInequalityConstraint(
+            lessKey,
+            Constraint::Operator::LessThan,
+            greaterKey
+        );
+    }
+    return out;
+}
+
+std::vector<Futoshiki> Futoshiki::Variants() const {
+    std::vector<Futoshiki> out;
+    for (const auto& transform : BoardTransform::All()) {
+        auto variant = Transformed(transform);
+        bool seen = std::any_of(out.begin(), out.end(), [&variant](const Futoshiki& other) {
+            return SameClues(variant, other);
+        });
+        if (!seen) {
+            out.push_back(std::move(variant));
+        }
+    }
+    return out;
+}
+
+crow::json::wvalue Futoshiki::CanonicalForm::Serialize() const {
+    std::ostringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    
+    auto out = crow::json::wvalue();
+    out["hash"] = hex.str();
+    out["transform"] = transform.Serialize();
+    return out;
+}
+
+Futoshiki::CanonicalForm Futoshiki::Canonicalize() const {
+    // as many mask words per cell as its values (1 to size) need: one, as for
+    // GetDomainMasks, below a size of 64
+    const unsigned long wordsPerCell = m_size / 64 + 1;
+    std::vector< std::vector<int> > possibleValues;
+    for (const auto& [cellKey, cell] : m_cells) {
+        const auto& values = cell->GetPossibleValuesRef();
+        possibleValues.emplace_back(values.begin(), values.end());
+    }
+    const auto inequalities = Inequalities();
+    
+    CanonicalForm out {BoardTransform(), {}, 0};
+    std::vector<std::uint64_t> key;
+    std::vector<Inequality> mapped;
+    for (const auto& transform : BoardTransform::All()) {
+        key.assign(possibleValues.size() * wordsPerCell, 0);
+        for (unsigned long cellKey = 0; cellKey < possibleValues.size(); ++cellKey) {
+            auto words = key.begin() + static_cast<long>(transform.ApplyToKey(cellKey, m_size) * wordsPerCell);
+            for (auto val : possibleValues[cellKey]) {
+                auto mappedVal = static_cast<unsigned long>(transform.ApplyToValue(val, m_size));
+                words[static_cast<long>(mappedVal / 64)] |= std::uint64_t(1) << (mappedVal % 64);
+            }
+        }
+        
+        mapped.clear();
+        for (const auto& inequality : inequalities) {
+            auto lessKey = transform.ApplyToKey(inequality.lessKey, m_size);
+            auto greaterKey = transform.ApplyToKey(inequality.greaterKey, m_size);
+            if (transform.reverseValues) {
+                std::swap(lessKey, greaterKey);
+            }
+            mapped.push_back({lessKey, greaterKey});
+        }
+        // the same inequality twice says nothing more
+        std::sort(mapped.begin(), mapped.end());
+        mapped.erase(std::unique(mapped.begin(), mapped.end(), [](const auto& lhs, const auto& rhs) {
+            return !(lhs < rhs) && !(rhs < lhs);
+        }), mapped.end());
+        for (const auto& inequality : mapped) {
+            key.push_back(inequality.lessKey);
+            key.push_back(inequality.greaterKey);
+        }
+        
+        // the identity comes first, so a representative maps to itself
+        if (transform.IsIdentity() || key < out.key) {
+            out.transform = transform;
+            std::swap(out.key, key);
+        }
+    }
+    out.hash = HashKey(m_size, out.key);
+    return out;
+}
+
+bool Futoshiki::IsEmptyBoard() const {
+    if (!Inequalities().empty()) {
+        return false;
+    }
+    for (const auto& [key, cell] : m_cells) {
+        if (cell->IsSolved() || cell->GetPossibleValuesRef().size() != m_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SymmetryBreaking Futoshiki::FindSymmetries() const {
+    SymmetryBreaking out;
+    if (IsEmptyBoard()) {
+        // n! (n - 1)! latin squares per reduced one, if that fits
+        unsigned long multiplier = 1;
+        bool fits = true;
+        for (unsigned long i = 2; i <= m_size && fits; ++i) {
+            auto factor = i < m_size ? i * i : i;
+            fits = multiplier <= std::numeric_limits<unsigned long>::max() / factor;
+            multiplier *= factor;
+        }
+        if (!fits) {
+            return out;
+        }
+        for (unsigned long col = 0; col < m_size; ++col) {
+            out.fixedCells.push_back({col, static_cast<int>(col + 1)});
+        }
+        for (unsigned long row = 1; row < m_size; ++row) {
+            out.fixedCells.push_back({row * m_size, static_cast<int>(row + 1)});
+        }
+        out.fixedCellsMultiplier = multiplier;
+        return out;
+    }
+    
+    for (const auto& transform : BoardTransform::All()) {
+        if (!transform.IsIdentity() && IsSymmetricUnder(transform)) {
+            out.symmetries.push_back(ToSymmetry(transform));
+        }
+    }
+    return out;
+}
+
+CspSymmetry Futoshiki::RandomSymmetry() const {
+    std::mt19937 gen{std::random_device{}()};
+    if (!IsEmptyBoard()) {
+        auto symmetries = FindSymmetries().symmetries;
+        symmetries.push_back({}); // the identity
+        return *Utils::SelectRandomly(symmetries.begin(), symmetries.end(), gen);
+    }
+    
+    // permute the values, the rows and the columns
+    std::vector<int> values(m_size);
+    std::iota(values.begin(), values.end(), 1);
+    std::shuffle(values.begin(), values.end(), gen);
+    std::vector<unsigned long> rows(m_size);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::shuffle(rows.begin(), rows.end(), gen);
+    auto cols = rows;
+    std::shuffle(cols.begin(), cols.end(), gen);
+    
+    CspSymmetry out;
+    out.valueMap.push_back(Cell::kUnsolvedSymbol);
+    out.valueMap.insert(out.valueMap.end(), values.begin(), values.end());
+    for (unsigned long key = 0; key < m_size * m_size; ++key) {
+        out.cellMap.push_back(rows[key / m_size] * m_size + cols[key % m_size]);
+    }
     return out;
 }
 
+std::optional< std::vector<std::uint8_t> > Futoshiki::SearchLocally(
+    unsigned long maxSteps,
+    const SolveBudget& budget
+) const {
+    if (GetDomainMasks().empty()) {
+        return std::nullopt; // the values do not fit into the masks of LocalSearch
+    }
+    LocalSearchOptions options;
+    options.budget = budget;
+    options.maxSteps = maxSteps;
+    auto res = LocalSearch(*this, options).Run();
+    if (!res.found) {
+        VLOG(1) << "Local search found no solution in " << res.steps << " moves";
+        return std::nullopt;
+    }
+    return res.values;
+}
+
 }  // ::Csp
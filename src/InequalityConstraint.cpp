@@ -93,13 +93,14 @@ bool InequalityConstraint::Apply() {
     bool constraintWasValid = true;
     switch (m_operator) {
         case Operator::LessThan: {
-            constraintWasValid = m_lhsCell.lock()->EnforceLessThan( m_rhsCell.lock()->MaxPossible() );
-            constraintWasValid &= m_rhsCell.lock()->EnforceGreaterThan( m_lhsCell.lock()->MinPossible() );
+            // the second step reads the first cell, which is empty if the first step failed
+            constraintWasValid = m_lhsCell.lock()->EnforceLessThan( m_rhsCell.lock()->MaxPossible() )
+                && m_rhsCell.lock()->EnforceGreaterThan( m_lhsCell.lock()->MinPossible() );
             break;
         }
         case Operator::GreaterThan: {
-            constraintWasValid = m_lhsCell.lock()->EnforceGreaterThan( m_rhsCell.lock()->MinPossible() );
-            constraintWasValid &= m_rhsCell.lock()->EnforceLessThan( m_lhsCell.lock()->MaxPossible() );
+            constraintWasValid = m_lhsCell.lock()->EnforceGreaterThan( m_rhsCell.lock()->MinPossible() )
+                && m_rhsCell.lock()->EnforceLessThan( m_lhsCell.lock()->MaxPossible() );
             break;
         }
         default:
@@ -140,6 +141,14 @@ std::vector<std::string> InequalityConstraint::GetCellIds() const {
     return { m_lhsCell.lock()->Id(), m_rhsCell.lock()->Id()};
 }
 
+unsigned long InequalityConstraint::LhsKey() const {
+    return m_lhsCell.lock()->Key();
+}
+
+unsigned long InequalityConstraint::RhsKey() const {
+    return m_rhsCell.lock()->Key();
+}
+
 crow::json::wvalue InequalityConstraint::Serialize() const {
     auto out = crow::json::wvalue();
     
@@ -0,0 +1,123 @@
+//
+//  LatinSquareSampler.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/LatinSquareSampler.hpp>
+
+#include <futoshiki/utils/Utils.hpp>
+
+namespace Csp {
+
+LatinSquareSampler::LatinSquareSampler(
+    unsigned long size,
+    unsigned long mixingSteps,
+    std::optional<unsigned int> seed
+)
+    : m_size(size)
+    , m_mixingSteps(mixingSteps > 0 ? mixingSteps : size * size)
+    , m_cube(size * size * size, 0)
+    , m_proper(true)
+    , m_improperRow(0)
+    , m_improperCol(0)
+    , m_improperVal(0)
+    , m_gen(seed ? *seed : std::random_device{}())
+{
+    assertm(size > 0 && size < 256, "values of the square should fit into a byte");
+    // start from the cyclic square
+    for (unsigned long row = 0; row < size; ++row) {
+        for (unsigned long col = 0; col < size; ++col) {
+            At(row, col, (row + col) % size) = 1;
+        }
+    }
+}
+
+void LatinSquareSampler::Step() {
+    unsigned long row, col, val;
+    // the 1s on the lines through (row, col, val): one each on a proper
+    // square, two each around the -1
+    unsigned long otherRows[2], otherCols[2], otherVals[2];
+    int numRows = 0, numCols = 0, numVals = 0;
+    
+    if (m_proper) {
+        // any 0 entry, then the 1s on its lines are unique
+        std::uniform_int_distribution<unsigned long> dist(0, m_size - 1);
+        do {
+            row = dist(m_gen);
+            col = dist(m_gen);
+            val = dist(m_gen);
+        }
+        while (At(row, col, val) != 0);
+    }
+    else {
+        // the -1 entry, which has two 1s on each of its lines
+        row = m_improperRow;
+        col = m_improperCol;
+        val = m_improperVal;
+    }
+    
+    for (unsigned long idx = 0; idx < m_size; ++idx) {
+        if (At(idx, col, val) == 1) {
+            otherRows[numRows++] = idx;
+        }
+        if (At(row, idx, val) == 1) {
+            otherCols[numCols++] = idx;
+        }
+        if (At(row, col, idx) == 1) {
+            otherVals[numVals++] = idx;
+        }
+    }
+    assertm(numRows > 0 && numCols > 0 && numVals > 0, "every line of the cube should sum to 1");
+    std::bernoulli_distribution coin;
+    auto otherRow = otherRows[numRows > 1 && coin(m_gen) ? 1 : 0];
+    auto otherCol = otherCols[numCols > 1 && coin(m_gen) ? 1 : 0];
+    auto otherVal = otherVals[numVals > 1 && coin(m_gen) ? 1 : 0];
+    
+    ++At(row, col, val);
+    ++At(row, otherCol, otherVal);
+    ++At(otherRow, col, otherVal);
+    ++At(otherRow, otherCol, val);
+    --At(row, col, otherVal);
+    --At(row, otherCol, val);
+    --At(otherRow, col, val);
+    --At(otherRow, otherCol, otherVal);
+    
+    m_proper = At(otherRow, otherCol, otherVal) >= 0;
+    if (!m_proper) {
+        m_improperRow = otherRow;
+        m_improperCol = otherCol;
+        m_improperVal = otherVal;
+    }
+}
+
+std::vector<std::uint8_t> LatinSquareSampler::Sample() {
+    // counting only the moves from proper squares: the proper squares the
+    // chain visits are uniform in the limit, but the first proper square after
+    // a fixed number of moves is not. A 1 x 1 cube has no 0 entry to move
+    // from, and only the one square anyway.
+    const auto mixingSteps = m_size < 2 ? 0 : m_mixingSteps;
+    for (unsigned long step = 0; step < mixingSteps; ++step) {
+        do {
+            Step();
+        }
+        while (!m_proper);
+    }
+    
+    std::vector<std::uint8_t> out;
+    out.reserve(m_size * m_size);
+    for (unsigned long row = 0; row < m_size; ++row) {
+        for (unsigned long col = 0; col < m_size; ++col) {
+            for (unsigned long val = 0; val < m_size; ++val) {
+                if (At(row, col, val) == 1) {
+                    out.push_back(static_cast<std::uint8_t>(val + 1));
+                    break;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+} // ::Csp
@@ -0,0 +1,283 @@
+//
+//  LocalSearch.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/LocalSearch.hpp>
+
+#include <futoshiki/utils/Utils.hpp>
+#include <futoshiki/utils/easylogging++.h>
+
+#include <algorithm>
+
+namespace Csp {
+
+namespace {
+
+bool Possible(std::uint64_t domain, int val) {
+    return (domain >> val) & 1;
+}
+
+} // ::
+
+LocalSearch::LocalSearch(const Futoshiki& puzzle, const LocalSearchOptions& options)
+    : m_options(options)
+    , m_size(puzzle.Size())
+    , m_domains(puzzle.GetDomainMasks())
+    , m_fixed()
+    , m_inequalities(puzzle.Inequalities())
+    , m_inequalitiesOf(m_size * m_size)
+    , m_values(m_size * m_size, 0)
+    , m_colCounts(m_size, std::vector<unsigned long>(m_size + 1, 0))
+    , m_tabuUntil(m_size * m_size, std::vector<unsigned long>(m_size + 1, 0))
+    , m_step(0)
+    , m_gen(options.seed ? *options.seed : std::random_device{}())
+{
+    assertm(m_domains.size() == m_size * m_size, "values of the puzzle should fit into the domain masks");
+    for (auto domain : m_domains) {
+        // a power of two: a single possible value
+        m_fixed.push_back(domain != 0 && (domain & (domain - 1)) == 0);
+    }
+    for (std::size_t idx = 0; idx < m_inequalities.size(); ++idx) {
+        m_inequalitiesOf[m_inequalities[idx].lessKey].push_back(idx);
+        m_inequalitiesOf[m_inequalities[idx].greaterKey].push_back(idx);
+    }
+}
+
+bool LocalSearch::RandomBoard() {
+    for (auto& counts : m_colCounts) {
+        std::fill(counts.begin(), counts.end(), 0);
+    }
+    for (unsigned long row = 0; row < m_size; ++row) {
+        std::vector<bool> used(m_size + 1, false);
+        std::vector<unsigned long> freeCols;
+        for (unsigned long col = 0; col < m_size; ++col) {
+            auto key = Key(row, col);
+            if (!m_fixed[key]) {
+                freeCols.push_back(col);
+                continue;
+            }
+            int val = 0;
+            while (!Possible(m_domains[key], val)) {
+                ++val;
+            }
+            if (used[val]) {
+                return false;
+            }
+            used[val] = true;
+            m_values[key] = val;
+        }
+
+        std::vector<int> freeValues;
+        for (int val = 1; val <= static_cast<int>(m_size); ++val) {
+            if (!used[val]) {
+                freeValues.push_back(val);
+            }
+        }
+        std::shuffle(freeValues.begin(), freeValues.end(), m_gen);
+        for (std::size_t idx = 0; idx < freeCols.size(); ++idx) {
+            m_values[Key(row, freeCols[idx])] = freeValues[idx];
+        }
+        for (unsigned long col = 0; col < m_size; ++col) {
+            ++m_colCounts[col][m_values[Key(row, col)]];
+        }
+    }
+    for (auto& tabu : m_tabuUntil) {
+        std::fill(tabu.begin(), tabu.end(), 0);
+    }
+    return true;
+}
+
+long LocalSearch::Cost() const {
+    long cost = 0;
+    for (const auto& counts : m_colCounts) {
+        for (auto count : counts) {
+            cost += count > 1 ? count - 1 : 0;
+        }
+    }
+    for (const auto& inequality : m_inequalities) {
+        cost += m_values[inequality.lessKey] < m_values[inequality.greaterKey] ? 0 : 1;
+    }
+    for (std::size_t key = 0; key < m_values.size(); ++key) {
+        cost += Possible(m_domains[key], m_values[key]) ? 0 : 1;
+    }
+    return cost;
+}
+
+long LocalSearch::LocalCost(unsigned long row, unsigned long lhsCol, int lhsVal, unsigned long rhsCol, int rhsVal) const {
+    const auto lhsKey = Key(row, lhsCol);
+    const auto rhsKey = Key(row, rhsCol);
+    auto valueOf = [&](unsigned long key) {
+        return key == lhsKey ? lhsVal : (key == rhsKey ? rhsVal : m_values[key]);
+    };
+
+    long cost = 0;
+    cost += Possible(m_domains[lhsKey], lhsVal) ? 0 : 1;
+    cost += Possible(m_domains[rhsKey], rhsVal) ? 0 : 1;
+    for (auto key : {lhsKey, rhsKey}) {
+        for (auto idx : m_inequalitiesOf[key]) {
+            const auto& inequality = m_inequalities[idx];
+            // an inequality between the two cells is seen from both
+            if (key == rhsKey && (inequality.lessKey == lhsKey || inequality.greaterKey == lhsKey)) {
+                continue;
+            }
+            cost += valueOf(inequality.lessKey) < valueOf(inequality.greaterKey) ? 0 : 1;
+        }
+    }
+    return cost;
+}
+
+long LocalSearch::SwapDelta(unsigned long row, unsigned long lhsCol, unsigned long rhsCol) const {
+    const int lhsVal = m_values[Key(row, lhsCol)];
+    const int rhsVal = m_values[Key(row, rhsCol)];
+
+    // each column loses one value and gains the other
+    long delta = 0;
+    delta -= m_colCounts[lhsCol][lhsVal] > 1 ? 1 : 0;
+    delta += m_colCounts[lhsCol][rhsVal] > 0 ? 1 : 0;
+    delta -= m_colCounts[rhsCol][rhsVal] > 1 ? 1 : 0;
+    delta += m_colCounts[rhsCol][lhsVal] > 0 ? 1 : 0;
+
+    delta += LocalCost(row, lhsCol, rhsVal, rhsCol, lhsVal);
+    delta -= LocalCost(row, lhsCol, lhsVal, rhsCol, rhsVal);
+    return delta;
+}
+
+void LocalSearch::Swap(unsigned long row, unsigned long lhsCol, unsigned long rhsCol) {
+    auto& lhsVal = m_values[Key(row, lhsCol)];
+    auto& rhsVal = m_values[Key(row, rhsCol)];
+
+    // moving the values back is tabu for a while
+    m_tabuUntil[Key(row, lhsCol)][lhsVal] = m_step + m_options.tabuTenure;
+    m_tabuUntil[Key(row, rhsCol)][rhsVal] = m_step + m_options.tabuTenure;
+
+    --m_colCounts[lhsCol][lhsVal];
+    --m_colCounts[rhsCol][rhsVal];
+    std::swap(lhsVal, rhsVal);
+    ++m_colCounts[lhsCol][lhsVal];
+    ++m_colCounts[rhsCol][rhsVal];
+}
+
+bool LocalSearch::IsConflicted(unsigned long row, unsigned long col) const {
+    const auto key = Key(row, col);
+    if (m_colCounts[col][m_values[key]] > 1 || !Possible(m_domains[key], m_values[key])) {
+        return true;
+    }
+    for (auto idx : m_inequalitiesOf[key]) {
+        const auto& inequality = m_inequalities[idx];
+        if (m_values[inequality.lessKey] >= m_values[inequality.greaterKey]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<LocalSearch::Move> LocalSearch::ChooseMove(long cost, long bestCost) {
+    std::vector<unsigned long> conflicted;
+    for (unsigned long key = 0; key < m_values.size(); ++key) {
+        if (!m_fixed[key] && IsConflicted(key / m_size, key % m_size)) {
+            conflicted.push_back(key);
+        }
+    }
+    if (conflicted.empty()) {
+        return std::nullopt; // only fixed cells left in conflict
+    }
+
+    const auto key = *Utils::SelectRandomly(conflicted.begin(), conflicted.end(), m_gen);
+    const auto row = key / m_size;
+    const auto col = key % m_size;
+
+    std::vector<Move> candidates;
+    for (unsigned long otherCol = 0; otherCol < m_size; ++otherCol) {
+        if (otherCol == col || m_fixed[Key(row, otherCol)]) {
+            continue;
+        }
+        candidates.push_back({row, col, otherCol, SwapDelta(row, col, otherCol)});
+    }
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+
+    if (std::uniform_real_distribution<double>(0, 1)(m_gen) < m_options.noise) {
+        return *Utils::SelectRandomly(candidates.begin(), candidates.end(), m_gen);
+    }
+
+    std::vector<Move> best;
+    for (const auto& move : candidates) {
+        const bool tabu =
+            m_tabuUntil[Key(row, move.lhsCol)][m_values[Key(row, move.rhsCol)]] > m_step ||
+            m_tabuUntil[Key(row, move.rhsCol)][m_values[Key(row, move.lhsCol)]] > m_step;
+        // aspiration: tabu moves are fine if they beat the best board
+        if (tabu && cost + move.delta >= bestCost) {
+            continue;
+        }
+        if (best.empty() || move.delta < best.front().delta) {
+            best.clear();
+        }
+        if (best.empty() || move.delta == best.front().delta) {
+            best.push_back(move);
+        }
+    }
+    if (best.empty()) {
+        return *Utils::SelectRandomly(candidates.begin(), candidates.end(), m_gen);
+    }
+    return *Utils::SelectRandomly(best.begin(), best.end(), m_gen);
+}
+
+LocalSearch::Result LocalSearch::Run() {
+    Result out {false, {}, 0, 0, 0, false};
+    const auto startTime = SolveBudget::Clock::now();
+    m_step = 0;
+
+    if (!RandomBoard()) {
+        VLOG(1) << "Givens clash within a row";
+        out.bestCost = static_cast<unsigned long>(Cost());
+        return out;
+    }
+    long cost = Cost();
+    long bestCost = cost;
+    long runBestCost = cost;
+    unsigned long lastImprovement = 0;
+
+    while (cost > 0) {
+        if (m_step >= m_options.maxSteps || m_options.budget.Exhausted(m_step + 1, startTime)) {
+            VLOG(1) << "Local search gave up after " << m_step << " moves";
+            out.budgetExhausted = true;
+            break;
+        }
+        ++m_step;
+
+        auto move = ChooseMove(cost, runBestCost);
+        if (move) {
+            Swap(move->row, move->lhsCol, move->rhsCol);
+            cost += move->delta;
+        }
+        if (cost < runBestCost) {
+            runBestCost = cost;
+            lastImprovement = m_step;
+        }
+        bestCost = std::min(bestCost, cost);
+
+        if (!move || m_step - lastImprovement > m_options.restartAfter) {
+            VLOG(2) << "Local search stuck at " << runBestCost << " violations, restarting";
+            ++out.restarts;
+            RandomBoard();
+            cost = Cost();
+            runBestCost = cost;
+            lastImprovement = m_step;
+        }
+    }
+
+    out.steps = m_step;
+    out.bestCost = static_cast<unsigned long>(bestCost);
+    if (cost == 0) {
+        out.found = true;
+        out.values.assign(m_values.begin(), m_values.end());
+        VLOG(1) << "Local search found a solution after " << m_step << " moves";
+    }
+    return out;
+}
+
+} // ::Csp
@@ -0,0 +1,229 @@
+//
+//  NogoodDatabase.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/NogoodDatabase.hpp>
+
+#include <futoshiki/utils/Utils.hpp>
+#include <futoshiki/utils/easylogging++.h>
+
+#include <limits>
+
+namespace Csp {
+
+NogoodDatabase::NogoodDatabase(std::size_t capacity)
+    : m_capacity(capacity)
+    , m_nogoods()
+    , m_freeSlots()
+    , m_watchers()
+    , m_numStored(0)
+    , m_numAdded(0)
+    , m_numPropagations(0)
+{ }
+
+std::size_t NogoodDatabase::Add(const Nogood& nogood, bool permanent) {
+    if (nogood.empty() || (m_capacity == 0 && !permanent)) {
+        return kNotStored;
+    }
+
+    if (m_numStored >= m_capacity) {
+        auto evictIdx = EvictionCandidate();
+        if (evictIdx == m_nogoods.size()) {
+            if (!permanent) {
+                return kNotStored; // full of permanent nogoods
+            }
+        }
+        else {
+            Remove(evictIdx);
+        }
+    }
+
+    std::size_t idx;
+    if (!m_freeSlots.empty()) {
+        idx = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else {
+        idx = m_nogoods.size();
+        m_nogoods.emplace_back();
+    }
+
+    // size the watch lists up front, so they never reallocate while propagating
+    for (const auto& guess : nogood) {
+        if (guess.cellKey >= m_watchers.size()) {
+            m_watchers.resize(guess.cellKey + 1);
+        }
+    }
+
+    auto& stored = m_nogoods[idx];
+    stored.guesses = nogood;
+    stored.hits = 0;
+    stored.addedAt = m_numAdded++;
+    stored.permanent = permanent;
+    stored.alive = true;
+    ++m_numStored;
+
+    // the guesses are in the order they were made, so the last two are the
+    // ones that get undone first when backtracking
+    auto numGuesses = nogood.size();
+    Watch(idx, 0, numGuesses - 1);
+    Watch(idx, 1, numGuesses > 1 ? numGuesses - 2 : numGuesses - 1);
+    return idx;
+}
+
+void NogoodDatabase::Remove(std::size_t nogoodIdx) {
+    auto& stored = m_nogoods.at(nogoodIdx);
+    if (!stored.alive) {
+        return;
+    }
+    // the watch list entries are dropped lazily
+    stored.alive = false;
+    stored.guesses.clear();
+    m_freeSlots.push_back(nogoodIdx);
+    --m_numStored;
+}
+
+void NogoodDatabase::Clear() {
+    m_nogoods.clear();
+    m_freeSlots.clear();
+    m_watchers.clear();
+    m_numStored = 0;
+}
+
+bool NogoodDatabase::Propagate(
+    ConstraintSatisfactionProblem& csp,
+    const std::vector<unsigned long>& changedCells
+) {
+    for (auto cellKey : changedCells) {
+        if (cellKey >= m_watchers.size()) {
+            continue;
+        }
+
+        auto& watchers = m_watchers[cellKey];
+        std::size_t i = 0;
+        while (i < watchers.size()) {
+            auto nogoodIdx = watchers[i];
+            auto& stored = m_nogoods[nogoodIdx];
+
+            if (!WatchesCell(stored, cellKey)) {
+                // evicted, or the watch moved on: drop the stale entry
+                watchers[i] = watchers.back();
+                watchers.pop_back();
+                continue;
+            }
+
+            int watchSlot = -1;
+            for (int slot = 0; slot < 2; ++slot) {
+                const auto& watched = stored.guesses[stored.watches[slot]];
+                if (watched.cellKey == cellKey && csp.EvaluateGuess(watched) == GuessState::True) {
+                    watchSlot = slot;
+                    break;
+                }
+            }
+            if (watchSlot >= 0 && Visit(csp, nogoodIdx, watchSlot) == Outcome::Violated) {
+                return false;
+            }
+            ++i;
+        }
+    }
+    return true;
+}
+
+bool NogoodDatabase::PropagateAll(ConstraintSatisfactionProblem& csp) {
+    for (std::size_t nogoodIdx = 0; nogoodIdx < m_nogoods.size(); ++nogoodIdx) {
+        if (!m_nogoods[nogoodIdx].alive) {
+            continue;
+        }
+        auto& stored = m_nogoods[nogoodIdx];
+        if (stored.guesses.size() == 1) {
+            // nothing else has to hold first: refute the guess straight away
+            if (Visit(csp, nogoodIdx, 0) == Outcome::Violated) {
+                return false;
+            }
+            continue;
+        }
+        for (int slot = 0; slot < 2; ++slot) {
+            if (csp.EvaluateGuess(stored.guesses[stored.watches[slot]]) != GuessState::True) {
+                continue;
+            }
+            if (Visit(csp, nogoodIdx, slot) == Outcome::Violated) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+NogoodDatabase::Outcome NogoodDatabase::Visit(
+    ConstraintSatisfactionProblem& csp,
+    std::size_t nogoodIdx,
+    int watchSlot
+) {
+    auto& stored = m_nogoods[nogoodIdx];
+    auto otherIdx = stored.watches[1 - watchSlot];
+
+    for (std::size_t guessIdx = 0; guessIdx < stored.guesses.size(); ++guessIdx) {
+        if (guessIdx == stored.watches[0] || guessIdx == stored.watches[1]) {
+            continue;
+        }
+        if (csp.EvaluateGuess(stored.guesses[guessIdx]) != GuessState::True) {
+            Watch(nogoodIdx, watchSlot, guessIdx);
+            return Outcome::Watching;
+        }
+    }
+
+    // every guess apart from the other watched one holds
+    switch (csp.EvaluateGuess(stored.guesses[otherIdx])) {
+        case GuessState::True:
+            ++stored.hits;
+            ++m_numPropagations;
+            VLOG(3) << "Nogood violated";
+            return Outcome::Violated;
+        case GuessState::False:
+            return Outcome::Satisfied;
+        case GuessState::Undecided:
+            break;
+    }
+
+    ++stored.hits;
+    ++m_numPropagations;
+    VLOG(3) << "Nogood refutes " << stored.guesses[otherIdx].Serialize().dump();
+    return csp.RefuteGuess(stored.guesses[otherIdx]) ? Outcome::Refuted : Outcome::Violated;
+}
+
+void NogoodDatabase::Watch(std::size_t nogoodIdx, int watchSlot, std::size_t guessIdx) {
+    auto& stored = m_nogoods[nogoodIdx];
+    stored.watches[watchSlot] = guessIdx;
+
+    m_watchers[stored.guesses[guessIdx].cellKey].push_back(nogoodIdx);
+}
+
+bool NogoodDatabase::WatchesCell(const StoredNogood& stored, unsigned long cellKey) {
+    return stored.alive && (
+        stored.guesses[stored.watches[0]].cellKey == cellKey ||
+        stored.guesses[stored.watches[1]].cellKey == cellKey);
+}
+
+std::size_t NogoodDatabase::EvictionCandidate() const {
+    auto candidate = m_nogoods.size();
+    auto fewestHits = std::numeric_limits<unsigned long>::max();
+    auto oldest = std::numeric_limits<unsigned long>::max();
+    for (std::size_t idx = 0; idx < m_nogoods.size(); ++idx) {
+        const auto& stored = m_nogoods[idx];
+        if (!stored.alive || stored.permanent) {
+            continue;
+        }
+        // prefer evicting the least used, then the oldest
+        if (stored.hits < fewestHits || (stored.hits == fewestHits && stored.addedAt < oldest)) {
+            fewestHits = stored.hits;
+            oldest = stored.addedAt;
+            candidate = idx;
+        }
+    }
+    return candidate;
+}
+
+} // ::Csp
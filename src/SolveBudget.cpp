@@ -0,0 +1,25 @@
+//
+//  SolveBudget.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/SolveBudget.hpp>
+
+namespace Csp {
+
+bool SolveBudget::Exhausted(unsigned long nodes, Clock::time_point startTime) const {
+    if (maxNodes > 0 && nodes > maxNodes) {
+        return true;
+    }
+    if (cancellation && cancellation->IsCancelled()) {
+        return true;
+    }
+    if (deadline && Clock::now() >= *deadline) {
+        return true;
+    }
+    return maxTime.count() > 0 && Clock::now() - startTime >= maxTime;
+}
+
+} // ::Csp
@@ -0,0 +1,88 @@
+//
+//  TranspositionTable.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/TranspositionTable.hpp>
+
+namespace Csp {
+
+TranspositionTable::TranspositionTable(std::size_t capacity)
+    : m_capacity(capacity)
+    , m_entries()
+    , m_numStored(0)
+{ }
+
+// splitmix64: a fixed, well mixed key for every (cell, value)
+std::uint64_t TranspositionTable::Key(std::uint64_t cellIdx, std::uint64_t val) {
+    std::uint64_t z = cellIdx * 64 + val + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t TranspositionTable::Hash(const DomainMasks& domains) {
+    std::uint64_t hash = 0;
+    for (std::size_t cellIdx = 0; cellIdx < domains.size(); ++cellIdx) {
+        auto mask = domains[cellIdx];
+        for (std::uint64_t val = 0; mask != 0; ++val, mask >>= 1) {
+            if ((mask & 1) != 0) {
+                hash ^= Key(cellIdx, val);
+            }
+        }
+    }
+    return hash;
+}
+
+bool TranspositionTable::MayHold(std::uint64_t hash) const {
+    if (m_entries.empty()) {
+        return false;
+    }
+    const auto& entry = m_entries[hash % m_capacity];
+    return !entry.domains.empty() && entry.hash == hash;
+}
+
+std::optional<unsigned long> TranspositionTable::Lookup(std::uint64_t hash, const DomainMasks& domains) const {
+    if (m_entries.empty()) {
+        return std::nullopt;
+    }
+    const auto& entry = m_entries[hash % m_capacity];
+    if (entry.domains.empty() || entry.hash != hash || entry.domains != domains) {
+        return std::nullopt;
+    }
+    return entry.numSolutions;
+}
+
+void TranspositionTable::Store(std::uint64_t hash, const DomainMasks& domains, unsigned long numSolutions) {
+    if (m_capacity == 0 || domains.empty()) {
+        return;
+    }
+    if (m_entries.empty()) {
+        m_entries.resize(m_capacity);
+    }
+    auto& entry = m_entries[hash % m_capacity];
+    if (entry.domains.empty()) {
+        ++m_numStored;
+    }
+    entry.hash = hash;
+    entry.domains = domains;
+    entry.numSolutions = numSolutions;
+}
+
+void TranspositionTable::DropSolutionCounts() {
+    for (auto& entry : m_entries) {
+        if (!entry.domains.empty() && entry.numSolutions > 0) {
+            entry.domains.clear();
+            --m_numStored;
+        }
+    }
+}
+
+void TranspositionTable::Clear() {
+    m_entries.clear();
+    m_numStored = 0;
+}
+
+} // ::Csp
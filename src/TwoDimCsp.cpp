@@ -276,7 +276,7 @@ void TwoDimCsp::dPrintGrid() const {
     LOG(INFO) << ss.str();
 }
 
-bool TwoDimCsp::ValidCoords(const CellCoords& cords) {
+bool TwoDimCsp::ValidCoords(const CellCoords& cords) const {
     if (cords.first >= m_numCols) {
         return false;
     }
@@ -289,7 +289,7 @@ bool TwoDimCsp::ValidCoords(const CellCoords& cords) {
 }
 
 unsigned long TwoDimCsp::CoordsToIndex(const CellCoords& cords
-) {
+) const {
     assertm(ValidCoords(cords), "coordinates are not valid");
     return cords.second * m_numCols + cords.first;
 }
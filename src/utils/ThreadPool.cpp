@@ -0,0 +1,57 @@
+//
+//  ThreadPool.cpp
+//  futoshiki
+//
+//  Created by agent on 19/10/2026.
+//
+
+#include <futoshiki/utils/ThreadPool.hpp>
+
+#include <algorithm>
+
+namespace Utils {
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+    : m_workers()
+    , m_tasks()
+    , m_mutex()
+    , m_wakeUp()
+    , m_stopping(false)
+{
+    if (numThreads == 0) {
+        // (may be 0 if it cannot tell)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        m_workers.emplace_back(&ThreadPool::Work, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return; // stopping, and nothing left to do
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+} // ::Utils
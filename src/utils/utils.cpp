@@ -16,4 +16,22 @@ std::set<int> GenSetSequence(unsigned long size) {
     return s;
 }
 
+unsigned long Luby(unsigned long i) {
+    // find the finished subsequence of length 2^k - 1 that i falls into
+    unsigned long k = 1;
+    while (((1ul << k) - 1) < i) {
+        ++k;
+    }
+    // i ends the subsequence: the new largest term
+    // otherwise: we are repeating the subsequence one shorter
+    while (i != (1ul << k) - 1) {
+        i -= (1ul << (k - 1)) - 1;
+        k = 1;
+        while (((1ul << k) - 1) < i) {
+            ++k;
+        }
+    }
+    return 1ul << (k - 1);
+}
+
 } // ::Utils
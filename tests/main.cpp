@@ -8,9 +8,17 @@
 #include <futoshiki/InequalityConstraint.hpp>
 #include <futoshiki/EqualityConstraint.hpp>
 #include <futoshiki/Cell.hpp>
+#include <futoshiki/DomainSizeBuckets.hpp>
+#include <futoshiki/TranspositionTable.hpp>
+#include <futoshiki/LocalSearch.hpp>
+#include <futoshiki/LatinSquareSampler.hpp>
+#include <futoshiki/utils/Utils.hpp>
+#include <futoshiki/utils/ThreadPool.hpp>
 
 #include <futoshiki/utils/easylogging++.h>
 
+#include <thread>
+
 INITIALIZE_EASYLOGGINGPP
 
 TEST_CASE( "2x2 complete solve", "[latin]" ) {
@@ -104,3 +112,696 @@ TEST_CASE( "2x2 Generate", "[futoshiki]" ) {
     REQUIRE(solveRes.valid);
     REQUIRE(solveRes.completeSolve);
 }
+
+TEST_CASE( "Domain size buckets pick the smallest domain", "[buckets]" ) {
+    Csp::DomainSizeBuckets buckets;
+    buckets.Insert(0, 4);
+    buckets.Insert(1, 3);
+    buckets.Insert(2, 4);
+    buckets.Insert(3, 1); // solved, not tracked
+    
+    REQUIRE(buckets.Size() == 3);
+    REQUIRE(!buckets.Contains(3));
+    REQUIRE(buckets.SmallestDomainKey() == 1);
+    
+    buckets.Update(2, 2);
+    REQUIRE(buckets.SmallestDomainKey() == 2);
+    
+    buckets.Update(2, 1);
+    REQUIRE(!buckets.Contains(2));
+    REQUIRE(buckets.SmallestDomainKey() == 1);
+    
+    buckets.Update(1, 4);
+    buckets.Remove(0);
+    REQUIRE(buckets.Size() == 1);
+    REQUIRE(buckets.SmallestDomainKey() == 1);
+}
+
+TEST_CASE( "3x3 Multiple Solutions (solve unique)", "[latin]" ) {
+    auto csp = Csp::LatinSquare(3);
+    auto solver = Csp::CspSolver<Csp::LatinSquare>(std::move(csp));
+    auto res = solver.SolveUnique();
+    
+    REQUIRE(!res.completeSolve);
+    REQUIRE(res.reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::NotUnique);
+}
+
+TEST_CASE( "4x4 Invalid with nogood learning", "[futoshiki]" ) {
+    auto csp = Csp::Futoshiki(4);
+    csp.AddInequalityConstraint({1, 1}, Csp::Constraint::Operator::GreaterThan, {1, 2});
+    csp.AddInequalityConstraint({2, 3}, Csp::Constraint::Operator::LessThan, {3, 3});
+    csp.AddInequalityConstraint({2, 2}, Csp::Constraint::Operator::LessThan, {3, 2});
+    csp.AddInequalityConstraint({1, 0}, Csp::Constraint::Operator::GreaterThan, {2, 0});
+    csp.AddInequalityConstraint({2, 0}, Csp::Constraint::Operator::GreaterThan, {2, 1});
+    
+    Csp::SolverOptions options;
+    options.learnNogoods = true;
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(csp), options);
+    auto res = solver.Solve();
+    
+    REQUIRE(!res.completeSolve);
+    REQUIRE(res.reason.reasonType == Csp::CspSolver<Csp::Futoshiki>::SolveSolution::ReasonType::NoGuessesWorked);
+}
+
+TEST_CASE( "Random solve with Luby restarts", "[restarts]" ) {
+    REQUIRE(Utils::Luby(1) == 1);
+    REQUIRE(Utils::Luby(3) == 2);
+    REQUIRE(Utils::Luby(7) == 4);
+    REQUIRE(Utils::Luby(8) == 1);
+    
+    Csp::SolverOptions options;
+    options.learnNogoods = true;
+    options.restartPolicy = Csp::RestartPolicy::Luby;
+    options.restartUnit = 1;
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(6), options);
+    auto res = solver.SolveRandom();
+    
+    REQUIRE(res.completeSolve);
+    REQUIRE(solver.GetSolutions().size() == 1);
+}
+
+TEST_CASE( "Limited discrepancy search", "[lds]" ) {
+    auto generatedCsp = Csp::Futoshiki::Generate(5);
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(generatedCsp));
+    auto res = solver.SolveLimitedDiscrepancy();
+    
+    REQUIRE(res.completeSolve);
+    
+    auto invalidCsp = Csp::LatinSquare(
+        {
+            {
+                1,
+                Csp::Cell::kUnsolvedSymbol,
+                Csp::Cell::kUnsolvedSymbol
+            },
+            {
+                Csp::Cell::kUnsolvedSymbol,
+                2,
+                Csp::Cell::kUnsolvedSymbol
+            },
+            {
+                Csp::Cell::kUnsolvedSymbol,
+                Csp::Cell::kUnsolvedSymbol,
+                Csp::Cell::kUnsolvedSymbol
+            }
+        }
+    );
+    invalidCsp.AddInequalityConstraint({2, 0}, Csp::Constraint::Operator::LessThan, {2, 1});
+    invalidCsp.AddInequalityConstraint({2, 1}, Csp::Constraint::Operator::LessThan, {2, 2});
+    auto invalidSolver = Csp::CspSolver<Csp::LatinSquare>(std::move(invalidCsp));
+    auto invalidRes = invalidSolver.SolveLimitedDiscrepancy();
+    
+    REQUIRE(!invalidRes.completeSolve);
+    REQUIRE(!invalidRes.valid);
+}
+
+TEST_CASE( "Binary and domain splitting branching", "[branching]" ) {
+    auto generatedCsp = Csp::Futoshiki::Generate(5);
+    
+    auto enumerateSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp));
+    auto enumerateRes = enumerateSolver.SolveUnique();
+    REQUIRE(enumerateRes.completeSolve);
+    auto expected = enumerateSolver.GetSolutions().front().values;
+    
+    for (auto scheme : {Csp::BranchingScheme::Binary, Csp::BranchingScheme::DomainSplit}) {
+        Csp::SolverOptions options;
+        options.branching = scheme;
+        auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp), options);
+        auto res = solver.Solve();
+        
+        REQUIRE(res.completeSolve);
+        REQUIRE(solver.GetSolutions().front().values == expected);
+    }
+}
+
+TEST_CASE( "Count Latin square solutions", "[count]" ) {
+    auto solver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4));
+    auto count = solver.CountSolutions();
+    
+    REQUIRE(count.exact);
+    REQUIRE(count.count == 576);
+    REQUIRE(solver.GetSolutions().empty());
+    
+    Csp::SolverOptions options;
+    options.learnNogoods = true;
+    options.branching = Csp::BranchingScheme::Binary;
+    auto cappedSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), options);
+    auto cappedCount = cappedSolver.CountSolutions(10);
+    
+    REQUIRE(!cappedCount.exact);
+    REQUIRE(cappedCount.count == 10);
+}
+
+TEST_CASE( "Enumerate solutions one at a time", "[enumerate]" ) {
+    auto solver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(3));
+    auto enumerator = solver.EnumerateSolutions();
+    
+    std::set< std::vector<std::uint8_t> > seen;
+    while (auto solution = enumerator.Next()) {
+        REQUIRE(solution->size() == 9);
+        seen.insert(*solution);
+    }
+    
+    REQUIRE(seen.size() == 12);
+    REQUIRE(!enumerator.Next());
+    REQUIRE(solver.GetSolutions().empty());
+}
+
+TEST_CASE( "Check uniqueness guided by the first solution", "[unique]" ) {
+    auto generatedCsp = Csp::Futoshiki::Generate(5);
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp));
+    auto res = solver.CheckUnique();
+    
+    REQUIRE(res.completeSolve);
+    REQUIRE(solver.GetSolutions().size() == 1);
+    
+    // the temporary nogood is gone again
+    auto solveRes = solver.Solve();
+    REQUIRE(solveRes.completeSolve);
+    
+    auto multipleSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(3));
+    auto multipleRes = multipleSolver.CheckUnique();
+    
+    REQUIRE(!multipleRes.completeSolve);
+    REQUIRE(multipleRes.reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::NotUnique);
+}
+
+TEST_CASE( "Solve budgets and cancellation", "[budget]" ) {
+    Csp::SolverOptions options;
+    options.budget.maxNodes = 3;
+    auto solver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(6), options);
+    auto res = solver.SolveUnique();
+    
+    REQUIRE(!res.completeSolve);
+    REQUIRE(res.reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::BudgetExhausted);
+    
+    auto countSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), options);
+    auto count = countSolver.CountSolutions();
+    REQUIRE(count.budgetExhausted);
+    REQUIRE(!count.exact);
+    
+    auto token = std::make_shared<Csp::CancellationToken>();
+    token->Cancel();
+    Csp::SolverOptions cancelledOptions;
+    cancelledOptions.budget.cancellation = token;
+    auto cancelledSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), cancelledOptions);
+    auto cancelledRes = cancelledSolver.Solve();
+    REQUIRE(cancelledRes.reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::BudgetExhausted);
+    
+    Csp::GeneratorOptions generatorOptions;
+    generatorOptions.budget.cancellation = token;
+    REQUIRE_THROWS_AS(Csp::Futoshiki::Generate(4, generatorOptions), Csp::BudgetExhaustedError);
+    
+    // a deadline is not extended by the next solve
+    Csp::SolverOptions deadlineOptions;
+    deadlineOptions.budget.deadline = Csp::SolveBudget::Clock::now() + std::chrono::milliseconds(50);
+    auto deadlineSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), deadlineOptions);
+    REQUIRE(deadlineSolver.Solve().completeSolve);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    REQUIRE(deadlineSolver.Solve().reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::BudgetExhausted);
+    generatorOptions.budget.cancellation.reset();
+    generatorOptions.budget.deadline = deadlineOptions.budget.deadline;
+    REQUIRE_THROWS_AS(Csp::Futoshiki::Generate(4, generatorOptions), Csp::BudgetExhaustedError);
+}
+
+TEST_CASE( "Iterative deepening for unique solves", "[depth]" ) {
+    auto puzzle = Csp::Futoshiki::Generate(5);
+    
+    Csp::SolverOptions options;
+    options.iterativeDeepening = true;
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+    auto res = solver.SolveUnique();
+    
+    REQUIRE(res.completeSolve);
+    REQUIRE(res.reason.details.dump().find("provingDepth") != std::string::npos);
+    
+    // a generated puzzle is proven within the default limit
+    auto plainSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle));
+    REQUIRE(plainSolver.SolveUnique().completeSolve);
+    
+    // without a limit, the empty board is found to have several solutions
+    Csp::SolverOptions unlimitedOptions;
+    unlimitedOptions.maxGuessDepth = 0;
+    auto emptySolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(5), unlimitedOptions);
+    auto emptyRes = emptySolver.SolveUnique();
+    REQUIRE(emptyRes.reason.reasonType == Csp::CspSolver<Csp::LatinSquare>::SolveSolution::ReasonType::NotUnique);
+}
+
+TEST_CASE( "Probing values before guessing", "[probing]" ) {
+    Csp::SolverOptions options;
+    options.probeDepth = 2;
+    auto countSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), options);
+    auto count = countSolver.CountSolutions();
+    
+    REQUIRE(count.exact);
+    REQUIRE(count.count == 576);
+    REQUIRE(count.stats.probes > 0);
+    
+    auto puzzle = Csp::Futoshiki::Generate(5);
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+    auto res = solver.SolveUnique();
+    
+    REQUIRE(res.completeSolve);
+}
+
+TEST_CASE( "Transposition table of explored states", "[transpositions]" ) {
+    Csp::SolverOptions options;
+    options.transpositionTableSize = 1 << 12;
+    auto countSolver = Csp::CspSolver<Csp::LatinSquare>(Csp::LatinSquare(4), options);
+    auto count = countSolver.CountSolutions();
+    
+    REQUIRE(count.exact);
+    REQUIRE(count.count == 576);
+    
+    // the second search finds the root state in the table
+    auto recount = countSolver.CountSolutions();
+    REQUIRE(recount.count == 576);
+    REQUIRE(recount.stats.transpositionHits > 0);
+    REQUIRE(recount.stats.nodes < count.stats.nodes);
+    
+    Csp::TranspositionTable table(8);
+    Csp::TranspositionTable::DomainMasks domains {0b110, 0b010};
+    auto hash = Csp::TranspositionTable::Hash(domains);
+    REQUIRE(!table.MayHold(hash));
+    REQUIRE(!table.Lookup(hash, domains));
+    table.Store(hash, domains, 2);
+    REQUIRE(table.MayHold(hash));
+    REQUIRE(table.Lookup(hash, domains) == 2ul);
+    table.DropSolutionCounts();
+    REQUIRE(!table.Lookup(hash, domains));
+    
+    // the csp keeps the hash of its domains up to date as values are removed
+    Csp::Futoshiki puzzle(5);
+    puzzle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    puzzle.AddInequalityConstraint({1, 0}, Csp::Constraint::Operator::LessThan, {1, 1});
+    REQUIRE(puzzle.DomainHash() == Csp::TranspositionTable::Hash(puzzle.GetDomainMasks()));
+    REQUIRE(puzzle.RefuteGuess({6, 3}));
+    REQUIRE(puzzle.ApplyGuess({0, 2}));
+    REQUIRE(puzzle.DomainHash() == Csp::TranspositionTable::Hash(puzzle.GetDomainMasks()));
+    auto copy = puzzle;
+    REQUIRE(copy.ApplyGuess({12, 4}));
+    REQUIRE(copy.DomainHash() == Csp::TranspositionTable::Hash(copy.GetDomainMasks()));
+    REQUIRE(puzzle.DomainHash() != copy.DomainHash());
+}
+
+TEST_CASE( "Symmetry breaking", "[symmetry]" ) {
+    Csp::SolverOptions options;
+    options.breakSymmetries = true;
+    
+    auto emptySolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(4), options);
+    auto emptyCount = emptySolver.CountSolutions();
+    REQUIRE(emptyCount.exact);
+    REQUIRE(emptyCount.count == 576);
+    
+    // symmetric along the diagonal
+    Csp::Futoshiki puzzle(4);
+    puzzle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    puzzle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {0, 1});
+    REQUIRE(puzzle.IsSymmetricUnder({true, false, false, false}));
+    REQUIRE(!puzzle.IsSymmetricUnder({false, true, false, false}));
+    
+    auto plainSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle));
+    auto symmetricSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+    auto plainCount = plainSolver.CountSolutions();
+    auto symmetricCount = symmetricSolver.CountSolutions();
+    REQUIRE(symmetricCount.count == plainCount.count);
+    REQUIRE(symmetricCount.stats.nodes < plainCount.stats.nodes);
+    
+    auto randomSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(5), options);
+    REQUIRE(randomSolver.SolveRandom().completeSolve);
+    auto solution = randomSolver.SolutionCsp(randomSolver.GetSolutions().front().values);
+    auto checkSolver = Csp::CspSolver<Csp::Futoshiki>(std::move(solution));
+    REQUIRE(checkSolver.SolveDeterministic().completeSolve);
+}
+
+TEST_CASE( "Local search for complete boards", "[localsearch]" ) {
+    Csp::LocalSearchOptions options;
+    options.seed = 42;
+    auto res = Csp::LocalSearch(Csp::Futoshiki(12), options).Run();
+    
+    REQUIRE(res.found);
+    Csp::Futoshiki board(12);
+    REQUIRE(board.AssignCompactValues(res.values));
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(board));
+    REQUIRE(solver.SolveDeterministic().completeSolve);
+    
+    // a cycle of inequalities has no solution, which local search cannot tell
+    Csp::Futoshiki cycle(3);
+    cycle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    cycle.AddInequalityConstraint({1, 0}, Csp::Constraint::Operator::LessThan, {1, 1});
+    cycle.AddInequalityConstraint({1, 1}, Csp::Constraint::Operator::LessThan, {0, 1});
+    cycle.AddInequalityConstraint({0, 1}, Csp::Constraint::Operator::LessThan, {0, 0});
+    options.maxSteps = 500;
+    auto cycleRes = Csp::LocalSearch(cycle, options).Run();
+    REQUIRE(!cycleRes.found);
+    REQUIRE(cycleRes.budgetExhausted);
+    REQUIRE(cycleRes.bestCost > 0);
+    
+    // as the first try of Solve: the tree search alone runs out of nodes
+    Csp::Futoshiki givens(9);
+    givens.ApplyConstraint({Csp::Futoshiki::PuzzleConstraint::Type::Given, 0, Csp::Constraint::Operator::LessThan, 0, 3});
+    givens.ApplyConstraint({Csp::Futoshiki::PuzzleConstraint::Type::Given, 40, Csp::Constraint::Operator::LessThan, 0, 7});
+    Csp::SolverOptions solverOptions;
+    solverOptions.budget.maxNodes = 1;
+    REQUIRE(!Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(givens), solverOptions).Solve().completeSolve);
+    solverOptions.localSearchSteps = 1000000;
+    auto localSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(givens), solverOptions);
+    REQUIRE(localSolver.Solve().completeSolve);
+    auto localSolution = localSolver.GetSolutions().front().values;
+    REQUIRE(localSolution[0] == 3);
+    REQUIRE(localSolution[40] == 7);
+    REQUIRE(Csp::Futoshiki(givens).AssignCompactValues(localSolution));
+}
+
+TEST_CASE( "Sampling latin squares", "[sampler]" ) {
+    Csp::LatinSquareSampler sampler(9, 0, 42);
+    auto first = sampler.Sample();
+    auto second = sampler.Sample();
+    REQUIRE(first != second);
+    
+    for (const auto& values : {first, second}) {
+        Csp::Futoshiki board(9);
+        REQUIRE(board.AssignCompactValues(values));
+        auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(board));
+        REQUIRE(solver.SolveDeterministic().completeSolve);
+    }
+    
+    // the same seed gives the same squares
+    REQUIRE(Csp::LatinSquareSampler(9, 0, 42).Sample() == first);
+    
+    // nothing to mix on a single cell
+    REQUIRE(Csp::LatinSquareSampler(1).Sample() == std::vector<std::uint8_t>{1});
+    auto single = Csp::Futoshiki::Generate(1);
+    REQUIRE(Csp::CspSolver<Csp::Futoshiki>(std::move(single)).SolveDeterministic().completeSolve);
+}
+
+TEST_CASE( "Refining a puzzle between solves", "[incremental]" ) {
+    auto reference = Csp::LatinSquareSampler(5, 0, 7).Sample();
+    Csp::Futoshiki puzzle(5);
+    Csp::SolverOptions options;
+    options.learnNogoods = true;
+    options.maxGuessDepth = 0;
+    
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+    REQUIRE(solver.SolveUnique().reason.reasonType == Csp::CspSolver<Csp::Futoshiki>::SolveSolution::ReasonType::NotUnique);
+    
+    // the refined solver agrees with a fresh one on every step of the way
+    bool unique = false;
+    while (!unique) {
+        auto constraint = solver.Root().ChooseRandomConstraint(reference);
+        REQUIRE(constraint.has_value());
+        REQUIRE(puzzle.ApplyConstraint(*constraint));
+        REQUIRE(solver.Refine([&constraint](Csp::Futoshiki& csp) { return csp.ApplyConstraint(*constraint); }));
+        
+        unique = solver.SolveUnique().completeSolve;
+        auto freshSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+        REQUIRE(freshSolver.SolveUnique().completeSolve == unique);
+    }
+    REQUIRE(solver.GetSolutions().front().values == reference);
+}
+
+TEST_CASE( "Constraints against witness solutions", "[witnesses]" ) {
+    auto reference = Csp::LatinSquareSampler(4, 0, 3).Sample();
+    Csp::Futoshiki puzzle(4);
+    Csp::SolverOptions options;
+    options.maxGuessDepth = 0;
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(puzzle), options);
+    
+    REQUIRE(solver.SolveUnique().reason.reasonType == Csp::CspSolver<Csp::Futoshiki>::SolveSolution::ReasonType::NotUnique);
+    auto witnesses = solver.GetWitnesses();
+    REQUIRE(witnesses.size() == 2);
+    REQUIRE(witnesses.front() != witnesses.back());
+    witnesses.erase(std::remove(witnesses.begin(), witnesses.end(), reference), witnesses.end());
+    
+    auto constraint = puzzle.ChooseConstraintAgainst(reference, witnesses);
+    REQUIRE(constraint.has_value());
+    REQUIRE(constraint->HoldsFor(reference));
+    REQUIRE(std::any_of(witnesses.begin(), witnesses.end(), [&constraint](const std::vector<std::uint8_t>& witness) {
+        return !constraint->HoldsFor(witness);
+    }));
+    
+    // nothing rules out the reference itself
+    REQUIRE(!puzzle.ChooseConstraintAgainst(reference, {reference}).has_value());
+}
+
+TEST_CASE( "Scoring candidate constraints in parallel", "[candidates]" ) {
+    Utils::ThreadPool pool(2);
+    REQUIRE(pool.Size() == 2);
+    std::vector< std::future<int> > results;
+    for (int i = 0; i < 8; ++i) {
+        results.push_back(pool.Submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 8; ++i) {
+        REQUIRE(results[i].get() == i * i);
+    }
+    
+    Csp::GeneratorOptions options;
+    options.candidates = 4;
+    options.threads = 2;
+    for (auto scoring : {Csp::CandidateScoring::Propagation, Csp::CandidateScoring::SolutionCount}) {
+        options.candidateScoring = scoring;
+        auto generatedCsp = Csp::Futoshiki::Generate(5, options);
+        auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp));
+        REQUIRE(solver.CountSolutions(2).count == 1);
+    }
+}
+
+TEST_CASE( "Subtractive generation", "[subtractive]" ) {
+    Csp::GeneratorOptions options;
+    options.strategy = Csp::GenerationStrategy::Subtractive;
+    options.threads = 2;
+    options.removalBatch = 3;
+    auto generatedCsp = Csp::Futoshiki::Generate(5, options);
+    
+    // the clues of the puzzle, to take out one at a time
+    std::vector<Csp::Futoshiki::PuzzleConstraint> clues;
+    auto domains = generatedCsp.GetDomainMasks();
+    for (unsigned long key = 0; key < domains.size(); ++key) {
+        if ((domains[key] & (domains[key] - 1)) == 0) {
+            int val = 0;
+            while (!((domains[key] >> val) & 1)) {
+                ++val;
+            }
+            clues.push_back({Csp::Futoshiki::PuzzleConstraint::Type::Given, key, Csp::Constraint::Operator::EqualTo, key, val});
+        }
+    }
+    for (const auto& inequality : generatedCsp.Inequalities()) {
+        clues.push_back({Csp::Futoshiki::PuzzleConstraint::Type::Inequality, inequality.lessKey, Csp::Constraint::Operator::LessThan, inequality.greaterKey, 0});
+    }
+    
+    auto isUnique = [](Csp::Futoshiki&& puzzle) {
+        Csp::SolverOptions checkOptions;
+        checkOptions.maxGuessDepth = 4;
+        auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(puzzle), checkOptions);
+        return solver.SolveUnique().completeSolve;
+    };
+    REQUIRE(isUnique(Csp::Futoshiki(generatedCsp)));
+    // and minimal
+    for (std::size_t takenOut = 0; takenOut < clues.size(); ++takenOut) {
+        Csp::Futoshiki puzzle(5);
+        for (std::size_t idx = 0; idx < clues.size(); ++idx) {
+            if (idx != takenOut) {
+                REQUIRE(puzzle.ApplyConstraint(clues[idx]));
+            }
+        }
+        REQUIRE(!isUnique(std::move(puzzle)));
+    }
+}
+
+TEST_CASE( "Skipping hopeless uniqueness checks", "[quickfilter]" ) {
+    Csp::Futoshiki empty(4);
+    REQUIRE(empty.Log2SearchSpace() == Approx(32));
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(empty));
+    auto res = solver.SolveRandom();
+    REQUIRE(res.completeSolve);
+    REQUIRE(solver.SolutionCsp(solver.GetSolutions().front().values).Log2SearchSpace() == Approx(0));
+    
+    for (bool incremental : {true, false}) {
+        Csp::GeneratorOptions options;
+        options.incremental = incremental;
+        options.quickFilterSpace = 0.1;
+        auto generatedCsp = Csp::Futoshiki::Generate(6, options);
+        auto checkSolver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp));
+        REQUIRE(checkSolver.CountSolutions(2).count == 1);
+    }
+}
+
+TEST_CASE( "Rating difficulty by propagation level", "[difficulty]" ) {
+    // the inequalities settle every cell on their own
+    Csp::Futoshiki bounds(2);
+    bounds.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {0, 1});
+    bounds.AddInequalityConstraint({1, 1}, Csp::Constraint::Operator::LessThan, {1, 0});
+    auto boundsRating = Csp::CspSolver<Csp::Futoshiki>(std::move(bounds)).RateDifficulty();
+    REQUIRE(boundsRating.unique);
+    REQUIRE(boundsRating.Score() == 0);
+    
+    // the last cell takes the value missing from its row
+    auto nakedRating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki({
+        {1, 2, 3},
+        {2, 3, 1},
+        {3, 1, Csp::Cell::kUnsolvedSymbol},
+    })).RateDifficulty();
+    REQUIRE(nakedRating.unique);
+    REQUIRE(nakedRating.propagation == Csp::PropagationLevel::NakedSingles);
+    
+    // hidden singles settle it, but only if a row looks again at the values
+    // it removed itself
+    constexpr auto _ = Csp::Cell::kUnsolvedSymbol;
+    Csp::Futoshiki hidden({
+        {2, 3, 4, _, 6, _},
+        {_, _, _, 2, _, _},
+        {_, 1, _, _, _, _},
+        {_, _, _, _, _, _},
+        {_, _, _, _, _, 1},
+        {_, _, _, _, _, 2},
+    });
+    hidden.AddInequalityConstraint({0, 4}, Csp::Constraint::Operator::LessThan, {0, 5});
+    hidden.AddInequalityConstraint({3, 3}, Csp::Constraint::Operator::LessThan, {3, 2});
+    hidden.AddInequalityConstraint({2, 5}, Csp::Constraint::Operator::LessThan, {3, 5});
+    hidden.AddInequalityConstraint({2, 4}, Csp::Constraint::Operator::LessThan, {2, 5});
+    hidden.AddInequalityConstraint({5, 1}, Csp::Constraint::Operator::LessThan, {5, 0});
+    hidden.AddInequalityConstraint({2, 4}, Csp::Constraint::Operator::LessThan, {2, 3});
+    hidden.AddInequalityConstraint({2, 5}, Csp::Constraint::Operator::LessThan, {1, 5});
+    hidden.AddInequalityConstraint({4, 3}, Csp::Constraint::Operator::LessThan, {3, 3});
+    auto hiddenRating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(hidden)).RateDifficulty();
+    REQUIRE(hiddenRating.unique);
+    REQUIRE(hiddenRating.propagation == Csp::PropagationLevel::HiddenSingles);
+    Csp::SolverOptions hiddenOptions;
+    hiddenOptions.propagationLevel = Csp::PropagationLevel::HiddenSingles;
+    REQUIRE(Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(hidden), hiddenOptions).SolveDeterministic().completeSolve);
+    // the rating reports the solution it found on the way
+    Csp::CspSolver<Csp::Futoshiki>::SolveSolution hiddenRes;
+    Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(hidden)).RateDifficulty(hiddenRes);
+    REQUIRE(hiddenRes.completeSolve);
+    REQUIRE(hiddenRes.reason.details.dump().find("solutions") != std::string::npos);
+    
+    Csp::CspSolver<Csp::Futoshiki>::SolveSolution emptyRes;
+    auto emptyRating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(4)).RateDifficulty(emptyRes);
+    REQUIRE(!emptyRating.unique);
+    REQUIRE(emptyRating.guessDepth > 0);
+    REQUIRE(!emptyRes.completeSolve);
+    
+    // guessing carries on within the budget of the rating, which has probed
+    // the root by then
+    Csp::SolverOptions budgetOptions;
+    budgetOptions.budget.maxNodes = 1;
+    auto budgetRating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(4), budgetOptions).RateDifficulty(emptyRes);
+    REQUIRE(!budgetRating.unique);
+    REQUIRE(emptyRes.reason.reasonType == Csp::CspSolver<Csp::Futoshiki>::SolveSolution::ReasonType::BudgetExhausted);
+    REQUIRE(emptyRes.reason.details.dump().find("\"probes\":0") == std::string::npos);
+    
+    // the level of the rating solves the puzzle, the one below it does not
+    for (int i = 0; i < 5; ++i) {
+        auto generatedCsp = Csp::Futoshiki::Generate(5);
+        auto rating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp)).RateDifficulty();
+        REQUIRE(rating.unique);
+        if (rating.needsProbing || rating.guessDepth > 0) {
+            continue;
+        }
+        Csp::SolverOptions options;
+        options.propagationLevel = rating.propagation;
+        REQUIRE(Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp), options).SolveDeterministic().completeSolve);
+        if (rating.propagation != Csp::PropagationLevel::Bounds) {
+            options.propagationLevel = static_cast<Csp::PropagationLevel>(static_cast<int>(rating.propagation) - 1);
+            REQUIRE(!Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp), options).SolveDeterministic().completeSolve);
+        }
+    }
+}
+
+TEST_CASE( "Generating puzzles of a difficulty", "[difficulty]" ) {
+    for (unsigned int difficulty = 0; difficulty <= 4; ++difficulty) {
+        Csp::GeneratorOptions options;
+        options.difficulty = difficulty;
+        // the same puzzle every time (the removal batches follow the threads)
+        options.seed = 7;
+        options.threads = 1;
+        auto generatedCsp = Csp::Futoshiki::Generate(5, options);
+        auto rating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp)).RateDifficulty();
+        REQUIRE(rating.unique);
+        REQUIRE(rating.Score() == difficulty);
+    }
+    
+    // stops once the rating is sure to be higher
+    auto capped = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(4)).RateDifficulty(2);
+    REQUIRE(!capped.unique);
+    REQUIRE(!capped.needsProbing);
+    REQUIRE(capped.propagation == Csp::PropagationLevel::HiddenSingles);
+    
+    Csp::GeneratorOptions impossible;
+    impossible.difficulty = 4;
+    impossible.maxAttempts = 1;
+    // a 2x2 board never needs probing
+    REQUIRE_THROWS_AS(Csp::Futoshiki::Generate(2, impossible), Csp::BudgetExhaustedError);
+    impossible.difficulty = Csp::kMaxGeneratedDifficulty + 1;
+    REQUIRE_THROWS_AS(Csp::Futoshiki::Generate(5, impossible), std::invalid_argument);
+}
+
+TEST_CASE( "Variants of a puzzle", "[variants]" ) {
+    auto generatedCsp = Csp::Futoshiki::Generate(5);
+    auto solver = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp));
+    REQUIRE(solver.SolveUnique().completeSolve);
+    auto solution = solver.GetSolutions().front().values;
+    
+    // each variant is unique, with the solution moved by the transform
+    for (const auto& transform : Csp::BoardTransform::All()) {
+        auto variantSolver = Csp::CspSolver<Csp::Futoshiki>(generatedCsp.Transformed(transform));
+        REQUIRE(variantSolver.SolveUnique().completeSolve);
+        auto variantSolution = variantSolver.GetSolutions().front().values;
+        for (unsigned long key = 0; key < solution.size(); ++key) {
+            REQUIRE(variantSolution[transform.ApplyToKey(key, 5)] == transform.ApplyToValue(solution[key], 5));
+        }
+    }
+    
+    // symmetric along the diagonal, so transposing gives nothing new
+    Csp::Futoshiki puzzle(4);
+    puzzle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    puzzle.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {0, 1});
+    REQUIRE(puzzle.Variants().size() == 8);
+    REQUIRE(Csp::Futoshiki(4).Variants().size() == 1);
+    
+    // values too large for the domain masks move too
+    Csp::Futoshiki large(64);
+    REQUIRE(large.ApplyGuess({1, 64}));
+    Csp::BoardTransform transpose;
+    transpose.transpose = true;
+    transpose.reverseValues = true;
+    auto transposed = large.Transformed(transpose);
+    REQUIRE(transposed.CompactValues()[64] == 1);
+}
+
+TEST_CASE( "Canonical form of a puzzle", "[canonical]" ) {
+    auto generatedCsp = Csp::Futoshiki::Generate(5);
+    auto form = generatedCsp.Canonicalize();
+    
+    // every variant has the same representative
+    for (const auto& transform : Csp::BoardTransform::All()) {
+        auto variantForm = generatedCsp.Transformed(transform).Canonicalize();
+        REQUIRE(variantForm.key == form.key);
+        REQUIRE(variantForm.hash == form.hash);
+    }
+    REQUIRE(generatedCsp.Transformed(form.transform).Canonicalize().transform.IsIdentity());
+    
+    // the order of the clues does not matter, nor saying one twice
+    Csp::Futoshiki lhs(4);
+    lhs.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    lhs.AddInequalityConstraint({2, 1}, Csp::Constraint::Operator::GreaterThan, {2, 2});
+    Csp::Futoshiki rhs(4);
+    rhs.AddInequalityConstraint({2, 2}, Csp::Constraint::Operator::LessThan, {2, 1});
+    rhs.AddInequalityConstraint({1, 0}, Csp::Constraint::Operator::GreaterThan, {0, 0});
+    rhs.AddInequalityConstraint({0, 0}, Csp::Constraint::Operator::LessThan, {1, 0});
+    REQUIRE(lhs.Canonicalize().hash == rhs.Canonicalize().hash);
+    
+    lhs.ApplyGuess({5, 3});
+    REQUIRE(lhs.Canonicalize().hash != rhs.Canonicalize().hash);
+    
+    // values too large for the domain masks count too
+    Csp::Futoshiki large(64);
+    REQUIRE(large.ApplyGuess({0, 64}));
+    Csp::Futoshiki otherLarge(64);
+    REQUIRE(otherLarge.ApplyGuess({0, 63}));
+    auto largeForm = large.Canonicalize();
+    REQUIRE(largeForm.hash != otherLarge.Canonicalize().hash);
+    for (const auto& transform : Csp::BoardTransform::All()) {
+        REQUIRE(large.Transformed(transform).Canonicalize().hash == largeForm.hash);
+    }
+}
@@ -15,10 +15,16 @@
 
 #include <crow.h>
 
+#include <thread>
+
 INITIALIZE_EASYLOGGINGPP
 
 namespace {
-    constexpr auto kMaxPuzzleSizeGenerate = 6;
+    constexpr auto kMaxPuzzleSizeGenerate = 8;
+    // so a single request cannot keep a worker busy for long: every step of
+    // the request shares the deadline
+    constexpr auto kGenerateDeadline = std::chrono::seconds(10);
+    constexpr auto kSolveDeadline = std::chrono::seconds(5);
 }
 
 void AddHeaders(crow::response& response) {
@@ -67,10 +73,47 @@ int main(int argc, const char * argv[]) {
             return response;
         }
         
-        auto generatedCsp = Csp::Futoshiki::Generate(size);
-        crow::response response { generatedCsp.Serialize() };
-        AddHeaders(response);
-        return response;
+        const auto deadline = Csp::SolveBudget::Clock::now() + kGenerateDeadline;
+        Csp::GeneratorOptions options;
+        options.budget.deadline = deadline;
+        // the requests are handled on one thread, so the other cores are idle
+        options.candidates = std::thread::hardware_concurrency();
+        
+        // optional: the score of the difficulty rating to aim for
+        if (in.has("difficulty")) {
+            if (in["difficulty"].t() != crow::json::type::Number) {
+                crow::response response {400};
+                AddHeaders(response);
+                return response;
+            }
+            auto difficulty = in["difficulty"].i();
+            if (difficulty < 0 || difficulty > Csp::kMaxGeneratedDifficulty) {
+                crow::response response {400};
+                AddHeaders(response);
+                return response;
+            }
+            options.difficulty = static_cast<unsigned int>(difficulty);
+        }
+        try {
+            auto generatedCsp = Csp::Futoshiki::Generate(size, options);
+            Csp::SolverOptions ratingOptions;
+            ratingOptions.budget.deadline = deadline;
+            auto rating = Csp::CspSolver<Csp::Futoshiki>(Csp::Futoshiki(generatedCsp), ratingOptions).RateDifficulty();
+            
+            auto out = generatedCsp.Serialize();
+            out["difficulty"] = rating.Serialize();
+            // the same for every rotation, reflection or value reversal of it
+            out["canonical"] = generatedCsp.Canonicalize().Serialize();
+            crow::response response { std::move(out) };
+            AddHeaders(response);
+            return response;
+        }
+        catch (const Csp::BudgetExhaustedError& e) {
+            LOG(WARNING) << "Generate request ran out of time: " << e.what();
+            crow::response response {503};
+            AddHeaders(response);
+            return response;
+        }
     });
     
     CROW_ROUTE(app, "/solve")
@@ -125,11 +168,21 @@ int main(int argc, const char * argv[]) {
         }
         
         try {
+            const auto deadline = Csp::SolveBudget::Clock::now() + kSolveDeadline;
             auto csp = Csp::MakeFutoshikiFromJson(rows, constraints);  // can throw
-            auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(csp));
-            auto res = solver.SolveUnique();
+            auto canonical = csp.Canonicalize();
+            Csp::SolverOptions options;
+            options.budget.deadline = deadline;
+            auto solver = Csp::CspSolver<Csp::Futoshiki>(std::move(csp), options);
+            // solves it uniquely on the way, with iterative deepening: this
+            // reports the depth needed to prove uniqueness too
+            Csp::CspSolver<Csp::Futoshiki>::SolveSolution res;
+            auto rating = solver.RateDifficulty(res);
             
-            crow::response response {res.ToJson()};
+            auto out = res.ToJson();
+            out["difficulty"] = rating.Serialize();
+            out["canonical"] = canonical.Serialize();
+            crow::response response { std::move(out) };
             AddHeaders(response);
             return response;
         }